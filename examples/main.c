@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <time.h>
 #include <stdbool.h>
@@ -16,11 +17,18 @@ long int syscall(long int number, ...);
 // *** USA LA LIBRERIA CON I NUOVI NOMI ***
 #include "bouncing_balls.h"
 #include "time0.h"
+#include "risorse.h"
+#include "taskset.h"
+#include "simulatore.h"
+#include "watchdog.h"
+#include "contatori.h"
+#include "stress.h"
 
 #define MAX 100
 
-ALLEGRO_MUTEX *task_mutex = NULL; // Mutex globale per sincronizzare accesso ai dati dei task
 parametri par[MAX];               // Array dei parametri dei task
+bool in_rimozione[MAX];           // Terminazione chiesta, thread non ancora raccolto (slot occupato)
+risorsa risorsa_condivisa;        // Risorsa condivisa da tutti i task (sezione critica simulata)
 
 // Definizione struct sched_attr
 struct sched_attr {
@@ -61,7 +69,7 @@ int task_count()
 // Crea un nuovo task periodico e lo aggiunge alla visualizzazione
 void crea_periodico(void *(*miotask)(void *), schedulazione cl_sched, int indice, int per, int dedrel, int prio)
 {
-    al_lock_mutex(task_mutex); // Protegge l'accesso ai parametri del task
+    pthread_mutex_lock(time0_mutex()); // Protegge l'accesso ai parametri del task
     par[indice].id = indice;
     par[indice].periodo = per;
     par[indice].deadline = dedrel;
@@ -69,15 +77,47 @@ void crea_periodico(void *(*miotask)(void *), schedulazione cl_sched, int indice
     par[indice].sched = cl_sched;
     par[indice].deadperse = 0;
     par[indice].wcet = per / 3;
-    al_unlock_mutex(task_mutex);
+    pthread_mutex_unlock(time0_mutex());
 
+    risorsa_usata_da(&risorsa_condivisa, &par[indice]); // Ceiling aggiornato prima che il task possa usarla
+    bouncing_balls_add_task(&par[indice]);           // Lega lock e contesto grafico prima che il thread li legga
     crea_task(miotask, &par[indice]);                // Crea il thread del task
-    bouncing_balls_add_task(&par[indice]);           // Aggiunge il task alla visualizzazione
 
     printf("Task %d creato - P:%d ms, D:%d ms, Prio:%d\n",
            indice, per, dedrel, prio);
 }
 
+// Raccoglie i task rimossi con R che sono usciti (dal tick del timer): il thread grafico
+// non attende mai il confine del periodo, che con N può essere lontano fino a 60 s
+void raccoglie_rimossi(void)
+{
+    for (int k = 1; k < MAX; k++)
+    {
+        if (!in_rimozione[k])
+            continue;
+        int esito = raccoglie_task(&par[k]);
+        if (esito == 1)
+            continue; // Ancora in esecuzione fino al prossimo rilascio
+        in_rimozione[k] = false;
+        if (esito == 0) {
+            bouncing_balls_remove_task(par[k].vis_handle);
+            printf("Task %d rimosso\n", k);
+            memset(&par[k], 0, sizeof(parametri)); // Lo slot verrà riusato dal prossimo task
+        }
+    }
+}
+
+// Lavoro in mutua esclusione: attesa attiva di ms millisecondi
+static void sezione_critica(int ms)
+{
+    struct timespec fine, adesso;
+    clock_gettime(CLOCK_MONOTONIC, &fine);
+    aggiunge_millisecondi(&fine, ms);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+    } while (confronta_istanti(adesso, fine) < 0);
+}
+
 // Funzione eseguita da ogni task periodico
 void *periodico(void *arg)
 {
@@ -105,7 +145,13 @@ void *periodico(void *arg)
 
     while (1)
     {
-        bouncing_balls_notify_execution_start(i); // Notifica inizio esecuzione (colore pallina)
+        notifica_task(argp, NOTIFICA_INIZIO); // Notifica inizio esecuzione (colore pallina)
+
+        // Sezione critica sulla risorsa condivisa (il tempo di blocco finisce nelle statistiche)
+        if (risorsa_lock(&risorsa_condivisa, argp) == 0) {
+            sezione_critica(1);
+            risorsa_unlock(&risorsa_condivisa);
+        }
 
         // --- Simulazione carico di lavoro (commentato) ---
         // int lavoro = argp->periodo / 3;
@@ -114,11 +160,13 @@ void *periodico(void *arg)
         //     result += sin(j) * cos(j);
         // }
 
-        bouncing_balls_notify_execution_end(i); // Notifica fine esecuzione
+        notifica_task(argp, NOTIFICA_FINE); // Notifica fine esecuzione
 
         deadline_miss(argp);    // Verifica se la deadline è stata mancata
-        attende_periodo(argp);  // Attende il prossimo periodo
+        if (attende_periodo(argp)) // Attende il prossimo periodo
+            break;                 // Task rimosso (rimuove_task)
     }
+    return NULL;
 }
 
 // Permette all'utente di scegliere la politica di scheduling
@@ -147,27 +195,171 @@ schedulazione scegli_sched()
     }
 }
 
-int main() {
+// Permette all'utente di scegliere il protocollo della risorsa condivisa
+protocollo_risorsa scegli_protocollo()
+{
+    int scelta;
+    printf("Scegli protocollo per la risorsa condivisa:\n");
+    printf("1 - Priority Inheritance\n");
+    printf("2 - Priority Ceiling (richiede root)\n");
+    printf("3 - Stack Resource Policy\n");
+    printf("Scelta [1]: ");
+    if (scanf("%d", &scelta) != 1)
+        scelta = 1;
+    switch (scelta)
+    {
+    case 2:
+        return PROTOCOLLO_PCP;
+    case 3:
+        return PROTOCOLLO_SRP;
+    default:
+        return PROTOCOLLO_PI;
+    }
+}
+
+// Simula il task set in tempo virtuale (un iperperiodo) e stampa le deadline perse previste,
+// da confrontare con le statistiche del run reale
+void prevede_taskset(const parametri *set, int n)
+{
+    sim_statistiche *stat = calloc(n, sizeof(sim_statistiche));
+    if (!stat)
+        return;
+    sim_config cfg = {0};
+    cfg.num_cpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.politica = SIM_PER_TASK;
+    int miss = simula(set, n, &cfg, stat);
+    if (miss >= 0) {
+        printf("Simulazione (%d CPU, iperperiodo %lld ms): %d deadline perse previste\n",
+               cfg.num_cpu, sim_iperperiodo_ms(set, n), miss);
+        for (int k = 0; k < n; k++)
+            if (stat[k].deadperse > 0)
+                printf("  task %d: %d miss su %lld job, risposta max %.3f ms\n", stat[k].id,
+                       stat[k].deadperse, stat[k].job_rilasciati, stat[k].risposta_max_ns / 1e6);
+    }
+    free(stat);
+}
+
+// Riconfigura al volo l'ultimo task del set: periodo e deadline moltiplicati per fattore,
+// con controllo di ammissione sul task set simulato (vale dal prossimo rilascio)
+void cambia_periodo(parametri *set, int n, double fattore)
+{
+    if (n <= 0)
+        return;
+    parametri *tp = &set[n - 1];
+    pthread_mutex_lock(mutex_task(tp));
+    modifica_task m = {tp->periodo, tp->deadline, tp->wcet, tp->priorita, tp->sched};
+    pthread_mutex_unlock(mutex_task(tp));
+    m.periodo = (int)(m.periodo * fattore);
+    m.deadline = (int)(m.deadline * fattore);
+    if (m.periodo < 10 || m.deadline < 1 || m.periodo > 60000) {
+        printf("Task %d: periodo %d ms fuori dai limiti della demo\n", tp->id, m.periodo);
+        return;
+    }
+    if (m.wcet > m.deadline)
+        m.wcet = m.deadline;
+    sim_insieme ins = {set, n, (int)sysconf(_SC_NPROCESSORS_ONLN), 0}; // Al più SIM_AMMISSIONE_DURATA_MS simulati
+    int esito = riconfigura_task(tp, &m, sim_ammissione, &ins);
+    if (esito == 0) {
+        risorsa_usata_da(&risorsa_condivisa, tp); // Il ceiling segue un'eventuale priorità più alta
+        printf("Task %d: P=%d ms, D=%d ms dal prossimo rilascio\n", tp->id, m.periodo, m.deadline);
+    } else if (esito == -2) {
+        printf("Task %d: P=%d ms rifiutato, la simulazione prevede deadline perse\n", tp->id, m.periodo);
+    } else if (esito == -3) {
+        printf("Task %d: P=%d ms non applicato, controllo di ammissione non riuscito\n", tp->id, m.periodo);
+    }
+}
+
+// Avvia tutti i task caricati da file con un rilascio sincrono comune
+void avvia_taskset(parametri *set, int n)
+{
+    // Il margine deve bastare a creare tutti i thread prima della partenza
+    taskset_rilascio_sincrono(set, n, 500 + n / 10);
+    // Tutti gli utenti della risorsa sono dichiarati prima che parta un qualunque task:
+    // nessun job la usa con un ceiling ancora troppo basso
+    for (int k = 0; k < n; k++)
+        risorsa_usata_da(&risorsa_condivisa, &set[k]);
+    int nascosti = 0; // Task oltre la capacità della visualizzazione
+    for (int k = 0; k < n; k++)
+    {
+        // Prima di crea_task: bouncing_balls_add_task scrive params->lock e params->vis
+        if (bouncing_balls_add_task(&set[k]) == 0)
+            nascosti++;
+        crea_task(periodico, &set[k]);
+    }
+    printf("Avviati %d task con partenza sincrona\n", n);
+    if (nascosti > 0)
+        fprintf(stderr, "Attenzione: %d task oltre la capacità della visualizzazione "
+                "(ricompilare con make MAX_BALLS=...): girano ma non compaiono in palline, "
+                "statistiche e timeline\n", nascosti);
+}
+
+// Termina tutti i task prima di liberare grafica e risorsa condivisa, che i loro job usano:
+// la terminazione è chiesta a tutti insieme, quindi l'attesa è al più il periodo più lungo
+void termina_tutti(parametri *set, int n)
+{
+    for (int k = 1; k < MAX; k++)
+        if (par[k].id > 0)
+            termina_task(&par[k]);
+    for (int k = 0; k < n; k++)
+        termina_task(&set[k]);
+    printf("Attendo la fine dei task (al loro prossimo rilascio)...\n");
+    for (int k = 1; k < MAX; k++)
+        if (par[k].id > 0)
+            rimuove_task(&par[k]);
+    for (int k = 0; k < n; k++)
+        rimuove_task(&set[k]);
+}
+
+int main(int argc, char **argv) {
     int i = 1; // Indice per i nuovi task
+    parametri *caricati = NULL; // Task set caricato da file (argv[1]), NULL in modalità interattiva
+    int num_caricati = 0;
 
     printf("Bouncing Balls Library v%s\n", bouncing_balls_get_version());
+
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+        // Rampa di schedulabilità simulata per ogni politica (CSV su file o stdout)
+        FILE *csv = argc > 2 ? fopen(argv[2], "w") : stdout;
+        if (!csv) {
+            perror(argv[2]);
+            return 1;
+        }
+        stress_config cfg = {0};
+        cfg.seme = 1;
+        int esito = stress_esegui(&cfg, csv);
+        if (csv != stdout)
+            fclose(csv);
+        return esito == 0 ? 0 : 1;
+    }
+
+    if (argc > 1) {
+        // Tutto il file viene validato prima di creare qualunque thread
+        char err[256];
+        num_caricati = taskset_carica(argv[1], &caricati, err, sizeof(err));
+        if (num_caricati < 0) {
+            fprintf(stderr, "Task set non valido: %s\n", err);
+            return 1;
+        }
+        printf("Caricati %d task da %s\n", num_caricati, argv[1]);
+        prevede_taskset(caricati, num_caricati);
+        i = MAX; // I task arrivano dal file: niente creazione da tastiera
+    }
     
     if (!al_init()) { // Inizializza Allegro
         fprintf(stderr, "Errore inizializzazione Allegro\n");
         return 1;
     }
     
-    task_mutex = al_create_mutex(); // Crea mutex globale
-    if (!task_mutex) {
-        fprintf(stderr, "Errore creazione mutex\n");
+    // Scegli scheduling e protocollo (con un task set da file: politica del primo task e PI)
+    schedulazione sched = caricati ? caricati[0].sched : scegli_sched();
+    protocollo_risorsa protocollo = caricati ? PROTOCOLLO_PI : scegli_protocollo();
+    if (risorsa_init(&risorsa_condivisa, protocollo, 0) != 0) {
+        fprintf(stderr, "Errore inizializzazione risorsa condivisa\n");
         return 1;
     }
-
-    schedulazione sched = scegli_sched(); // Scegli scheduling
     
     if (!bouncing_balls_init(800, 600)) { // Inizializza la libreria grafica
         fprintf(stderr, "Errore inizializzazione libreria\n");
-        al_destroy_mutex(task_mutex);
         return 1;
     }
 
@@ -186,13 +378,34 @@ int main() {
 
     al_start_timer(timer); // Avvia il timer principale
 
+    // Il watchdog segnala le deadline superate anche dai job ancora in esecuzione
+    if (watchdog_avvia(NULL, NULL) != 0)
+        fprintf(stderr, "Watchdog non avviato: i miss si vedono solo a fine job\n");
+
+    if (caricati)
+        avvia_taskset(caricati, num_caricati);
+
     printf("==== Task Periodici con Visualizzazione ====\n");
     printf("SPAZIO = aggiungi task (max %d)\n", MAX - 1);
     printf("D = aggiungi task con deadline ridotta (per forzare miss)\n");
+    printf("C = attiva/disattiva urti tra palline\n");
+    printf("S = mostra/nascondi statistiche per task (esecuzioni, miss, blocco)\n");
+    printf("H = rilascio con sleep / ibrido sleep + attesa attiva (jitter nelle statistiche)\n");
+    printf("P = contatori di prestazioni per job (IPC, cache miss, cambi di contesto) nelle statistiche\n");
+    printf("R = rimuovi l'ultimo task aggiunto da tastiera (termina al prossimo rilascio)\n");
+    printf("M / N = dimezza / raddoppia periodo e deadline dell'ultimo task (con controllo di ammissione)\n");
+    printf("T = mostra/nascondi la timeline (Gantt degli ultimi 10 s)\n");
+    printf("L = cambia livello di dettaglio (auto/palline/densità), rotella = zona di fuoco\n");
     printf("ESC = uscita\n");
 
     bool running = true;
     bool redraw = true;
+    bool collisions = false;
+    bouncing_balls_lod_mode lod = BB_LOD_AUTO;
+    int focus_radius = 80; // Raggio della zona di fuoco attorno al mouse
+    bool show_timeline = false;
+    bool show_stats = false;
+    bool rilascio_ibrido = false;
     while (running)
     {
         ALLEGRO_EVENT ev;
@@ -204,7 +417,12 @@ int main() {
         }
         else if (ev.type == ALLEGRO_EVENT_KEY_DOWN)
         {
-            if (ev.keyboard.keycode == ALLEGRO_KEY_SPACE && i < MAX)
+            if ((ev.keyboard.keycode == ALLEGRO_KEY_SPACE || ev.keyboard.keycode == ALLEGRO_KEY_D) &&
+                i < MAX && in_rimozione[i])
+            {
+                printf("Slot %d ancora in rimozione: riprova dopo il prossimo rilascio del task\n", i);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_SPACE && i < MAX)
             {
                 // Aggiungi un nuovo task con periodo e deadline uguali
                 printf("Creo task %d con P=D=%dms...\n", i, 100 * i);
@@ -222,11 +440,93 @@ int main() {
                 i++;
                 redraw = true;
             }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_R && !caricati && i > 1)
+            {
+                // Rimuovi l'ultimo task creato da tastiera: il thread esce al confine del periodo
+                // e viene raccolto dal tick del timer, che toglie anche la pallina
+                i--;
+                termina_task(&par[i]);
+                in_rimozione[i] = true;
+                printf("Task %d in rimozione (esce al prossimo rilascio)\n", i);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_C)
+            {
+                // Attiva/disattiva gli urti tra palline
+                collisions = !collisions;
+                bouncing_balls_set_collisions(collisions);
+                printf("Urti tra palline %s\n", collisions ? "attivi" : "disattivi");
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_T)
+            {
+                // Mostra/nasconde la timeline
+                show_timeline = !show_timeline;
+                bouncing_balls_set_timeline(show_timeline, 0);
+                redraw = true;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_S)
+            {
+                // Mostra/nasconde le statistiche per task
+                show_stats = !show_stats;
+                bouncing_balls_set_stats(show_stats);
+                redraw = true;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_H)
+            {
+                // Cambia il modo di rilascio di tutti i task (sleep / sleep + attesa attiva)
+                rilascio_ibrido = !rilascio_ibrido;
+                for (int k = 0; k < MAX; k++) {
+                    pthread_mutex_lock(mutex_task(&par[k]));
+                    par[k].attesa = rilascio_ibrido ? RILASCIO_IBRIDO : RILASCIO_SLEEP;
+                    pthread_mutex_unlock(mutex_task(&par[k]));
+                }
+                for (int k = 0; k < num_caricati; k++) {
+                    pthread_mutex_lock(mutex_task(&caricati[k]));
+                    caricati[k].attesa = rilascio_ibrido ? RILASCIO_IBRIDO : RILASCIO_SLEEP;
+                    pthread_mutex_unlock(mutex_task(&caricati[k]));
+                }
+                printf("Rilascio %s\n", rilascio_ibrido ? "ibrido (sleep + attesa attiva)" : "con sleep");
+                redraw = true;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_M || ev.keyboard.keycode == ALLEGRO_KEY_N)
+            {
+                // Cambia al volo il periodo dell'ultimo task, senza ricrearlo
+                double fattore = ev.keyboard.keycode == ALLEGRO_KEY_M ? 0.5 : 2.0;
+                if (caricati)
+                    cambia_periodo(caricati, num_caricati, fattore);
+                else
+                    cambia_periodo(&par[1], i - 1, fattore);
+                redraw = true;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_P)
+            {
+                // Attiva/disattiva i contatori di prestazioni per job
+                contatori_abilita(!contatori_abilitati());
+                printf("Contatori di prestazioni %s\n", contatori_abilitati() ? "attivi" : "disattivi");
+                redraw = true;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_L)
+            {
+                // Cicla tra le modalità di livello di dettaglio
+                lod = lod == BB_LOD_AUTO ? BB_LOD_BALLS : lod == BB_LOD_BALLS ? BB_LOD_DENSITY : BB_LOD_AUTO;
+                bouncing_balls_set_lod(lod, 0);
+                printf("LOD: %s\n", lod == BB_LOD_AUTO ? "auto" : lod == BB_LOD_BALLS ? "palline" : "densità");
+                redraw = true;
+            }
             if (ev.keyboard.keycode == ALLEGRO_KEY_ESCAPE)
             {
                 running = false; // Esci dal programma
             }
         }
+        else if (ev.type == ALLEGRO_EVENT_MOUSE_AXES) {
+            // La zona sotto il mouse mostra le palline singole; la rotella la allarga o stringe
+            focus_radius += ev.mouse.dz * 20;
+            if (focus_radius < 20) focus_radius = 20;
+            if (focus_radius > 400) focus_radius = 400;
+            bouncing_balls_set_focus(ev.mouse.x, ev.mouse.y, focus_radius);
+        }
+        else if (ev.type == ALLEGRO_EVENT_MOUSE_LEAVE_DISPLAY) {
+            bouncing_balls_set_focus(0, 0, 0);
+        }
         else if (ev.type == ALLEGRO_EVENT_DISPLAY_RESIZE) {
             // Gestisce il ridimensionamento della finestra
             int new_w = ev.display.width;
@@ -237,6 +537,7 @@ int main() {
         }
         else if (ev.type == ALLEGRO_EVENT_TIMER) {
             // Aggiorna la simulazione ad ogni tick del timer
+            raccoglie_rimossi();
             bouncing_balls_update();
             redraw = true;
         }
@@ -248,7 +549,12 @@ int main() {
         }
     }
 
+    termina_tutti(caricati, num_caricati);
+    watchdog_ferma();
+    contatori_stampa_riepilogo(par, MAX);
+    if (caricati)
+        contatori_stampa_riepilogo(caricati, num_caricati);
     bouncing_balls_shutdown(); // Libera risorse della libreria
-    al_destroy_mutex(task_mutex); // Libera il mutex
+    risorsa_distrugge(&risorsa_condivisa);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Processo real-time del modo a processi separati: esegue i task di un task set e
+// scrive le notifiche nell'anello in memoria condivisa. Non linka Allegro: la grafica
+// è nel processo visualizzatore, che può essere avviato, chiuso e riavviato a parte.
+//
+//   ./processo_rt taskset.txt [nome_segmento] [coroutine]
+//   ./visualizzatore [nome_segmento]
+//
+// Con "coroutine" i task girano come coroutine sull'esecutore (un worker per CPU)
+// invece che in un thread ciascuno.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "time0.h"
+#include "taskset.h"
+#include "watchdog.h"
+#include "evring.h"
+#include "esecutore.h"
+
+// Carico del job: attesa attiva di ms millisecondi
+static void esegue(int ms)
+{
+    struct timespec limite, adesso;
+    clock_gettime(CLOCK_MONOTONIC, &limite);
+    aggiunge_millisecondi(&limite, ms);
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+    } while (confronta_istanti(adesso, limite) < 0);
+}
+
+// Corpo dei task: un job lungo wcet per periodo (uguale per thread e coroutine)
+static void corpo(parametri *tp)
+{
+    do
+    {
+        notifica_task(tp, NOTIFICA_INIZIO);
+        esegue(tp->wcet);
+        notifica_task(tp, NOTIFICA_FINE);
+        deadline_miss(tp);
+    } while (!esecutore_attende_periodo(tp));
+}
+
+static void *periodico(void *arg)
+{
+    parametri *tp = (parametri *)arg;
+    set_period(tp);
+    corpo(tp);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Uso: %s taskset.txt [nome_segmento] [coroutine]\n", argv[0]);
+        return 1;
+    }
+    const char *nome = argc > 2 ? argv[2] : EVRING_NOME_DEFAULT;
+    int coroutine = argc > 3 && strcmp(argv[3], "coroutine") == 0;
+
+    char err[256];
+    parametri *tasks = NULL;
+    int n = taskset_carica(argv[1], &tasks, err, sizeof(err));
+    if (n < 0)
+    {
+        fprintf(stderr, "Task set non valido: %s\n", err);
+        return 1;
+    }
+
+    evring *anello = evring_crea(nome, 0);
+    if (!anello)
+        return 1;
+    time0_imposta_notifiche(evring_notifica, anello);
+    for (int k = 0; k < n; k++)
+        if (evring_registra_task(anello, &tasks[k]) != 0)
+            fprintf(stderr, "Task %d non visualizzabile: tabella piena\n", tasks[k].id);
+
+    // I segnali di controllo si bloccano prima di creare thread (che ereditano la maschera)
+    // e il main li riceve con sigwait: nessun gestore asincrono e nessun segnale perso
+    // tra un controllo e l'attesa
+    sigset_t segnali;
+    sigemptyset(&segnali);
+    sigaddset(&segnali, SIGINT);
+    sigaddset(&segnali, SIGTERM);
+    sigaddset(&segnali, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &segnali, NULL);
+
+    if (watchdog_avvia(NULL, NULL) != 0)
+        fprintf(stderr, "Watchdog non avviato: i miss si vedono solo a fine job\n");
+
+    esecutore *e = NULL;
+    if (coroutine)
+    {
+        // Politica e priorità dei worker: quelle del task più prioritario
+        schedulazione sched = OTHER;
+        int priorita = 0;
+        for (int k = 0; k < n; k++)
+        {
+            if (tasks[k].sched != OTHER && tasks[k].sched != DEADLINE && tasks[k].priorita >= priorita)
+            {
+                sched = tasks[k].sched;
+                priorita = tasks[k].priorita;
+            }
+        }
+        e = esecutore_crea(0, sched, priorita, 0);
+        if (!e)
+        {
+            fprintf(stderr, "Esecutore non creato\n");
+            return 1;
+        }
+    }
+
+    taskset_rilascio_sincrono(tasks, n, 500 + n / 10);
+    // I task che l'esecutore non riesce ad avviare (memoria, stack) escono dal task set:
+    // quelli avviati restano contigui in tasks, come serve alla rimozione con SIGUSR1
+    int avviati = 0;
+    for (int k = 0; k < n; k++)
+    {
+        if (avviati != k)
+            tasks[avviati] = tasks[k];
+        parametri *tp = &tasks[avviati];
+        if (!e)
+            crea_task(periodico, tp);
+        else if (esecutore_avvia_task(e, corpo, tp) != 0)
+        {
+            fprintf(stderr, "Task %d non avviato dall'esecutore\n", tp->id);
+            evring_rimuovi_task(anello, tp);
+            continue;
+        }
+        avviati++;
+    }
+    n = avviati;
+    printf("Avviati %d task %s, eventi su %s (incarnazione %u)\n", n,
+           e ? "a coroutine" : "a thread", nome, evring_incarnazione(anello));
+    printf("Avvia il visualizzatore in un altro terminale; CTRL+C per terminare,\n");
+    printf("kill -USR1 %d per rimuovere l'ultimo task\n", (int)getpid());
+
+    for (;;)
+    {
+        int sig;
+        if (sigwait(&segnali, &sig) != 0 || sig != SIGUSR1)
+            break;
+        if (n == 0)
+            continue;
+        // Il task esce al confine del periodo; la sua riga viene liberata solo dopo il join
+        parametri *tp = &tasks[n - 1];
+        if ((e ? esecutore_rimuove_task(e, tp) : rimuove_task(tp)) != 0)
+            continue;
+        evring_rimuovi_task(anello, tp);
+        printf("Task %d rimosso\n", tp->id);
+        n--;
+    }
+
+    // Prima si fermano i task (nessuno scrive più sull'anello né arma il watchdog),
+    // poi il watchdog
+    if (e)
+    {
+        printf("Cambi di contesto verso le coroutine: %lld\n", esecutore_cambi_contesto(e));
+        esecutore_distrugge(e);
+    }
+    else
+    {
+        for (int k = 0; k < n; k++)
+            rimuove_task(&tasks[k]);
+    }
+    watchdog_ferma();
+    printf("==== Deadline perse ====\n");
+    for (int k = 0; k < n; k++)
+        printf("Task %d: %d\n", tasks[k].id, tasks[k].deadperse);
+    free(tasks);
+    // Il segmento resta mappato fino all'uscita del processo: se ne toglie solo il nome
+    evring_elimina(nome);
+    return 0;
+}
@@ -0,0 +1,303 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Visualizzatore del modo a processi separati: si collega all'anello scritto dal
+// processo real-time (processo_rt) e lo disegna. Gira a priorità più bassa e può
+// essere chiuso e riavviato senza fermare i task; se il processo real-time viene
+// riavviato, il visualizzatore se ne accorge e ricostruisce le palline.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <allegro5/allegro.h>
+
+#include "bouncing_balls.h"
+#include "time0.h"
+#include "evring.h"
+
+#define EVENTI_PER_LETTURA 256
+#define INDICE_DIM (2 * EVRING_MAX_TASK)    // Posizioni dell'indice id -> riga (carico <= 1/2)
+
+static parametri locali[EVRING_MAX_TASK];  // Copie locali dei task della tabella condivisa
+static bb_handle pallina[EVRING_MAX_TASK];  // Pallina della riga (0 = non visualizzata)
+static int indice_riga[INDICE_DIM];         // Hash id -> riga + 1 (0 = vuoto), a indirizzamento aperto
+
+static unsigned int hash_id(int id)
+{
+    return ((unsigned int)id * 2654435761u) % INDICE_DIM;
+}
+
+// Ricostruisce l'indice dalle righe visualizzate (dopo ogni sincronizzazione)
+static void ricostruisce_indice(void)
+{
+    memset(indice_riga, 0, sizeof(indice_riga));
+    for (int k = 0; k < EVRING_MAX_TASK; k++)
+    {
+        if (!pallina[k])
+            continue;
+        unsigned int h = hash_id(locali[k].id);
+        while (indice_riga[h] && locali[indice_riga[h] - 1].id != locali[k].id)
+            h = (h + 1) % INDICE_DIM;
+        if (!indice_riga[h])
+            indice_riga[h] = k + 1; // Id ripetuto: vale la prima riga
+    }
+}
+
+// Attende che il processo real-time crei il segmento
+static evring *collega(const char *nome)
+{
+    evring *r;
+    bool avvisato = false;
+    while (!(r = evring_apri(nome)))
+    {
+        if (!avvisato)
+            printf("In attesa del processo real-time su %s...\n", nome);
+        avvisato = true;
+        struct timespec pausa = {0, 200 * 1000 * 1000};
+        nanosleep(&pausa, NULL);
+    }
+    printf("Collegato a %s (incarnazione %u)\n", nome, evring_incarnazione(r));
+    return r;
+}
+
+// Aggiunge le righe nuove della tabella, toglie le palline dei task rimossi (riga
+// liberata o riusata da un altro task) e aggiorna le statistiche delle altre
+static void sincronizza_task(evring *r)
+{
+    for (int k = 0; k < EVRING_MAX_TASK; k++)
+    {
+        parametri riga = {0};
+        int esito = evring_task(r, k, &riga);
+        if (esito < 0)
+            break;
+        if (pallina[k] && (esito == 0 || riga.id != locali[k].id))
+        {
+            bouncing_balls_remove_task(pallina[k]);
+            pallina[k] = 0;
+            memset(&locali[k], 0, sizeof(parametri));
+        }
+        if (esito == 0)
+            continue;
+        if (!pallina[k])
+        {
+            locali[k] = riga;
+            pallina[k] = bouncing_balls_add_task(&locali[k]);
+        }
+        else
+        {
+            parametri *tp = &locali[k];
+            pthread_mutex_lock(mutex_task(tp));
+            tp->periodo = riga.periodo;
+            tp->deadline = riga.deadline;
+            tp->priorita = riga.priorita;
+            tp->sched = riga.sched;
+            tp->wcet = riga.wcet;
+            tp->deadperse = riga.deadperse;
+            tp->blocco_max_ns = riga.blocco_max_ns;
+            tp->blocco_tot_ns = riga.blocco_tot_ns;
+            tp->jitter_max_ns = riga.jitter_max_ns;
+            tp->jitter_tot_ns = riga.jitter_tot_ns;
+            tp->rilasci = riga.rilasci;
+            pthread_mutex_unlock(mutex_task(tp));
+        }
+    }
+    ricostruisce_indice();
+}
+
+// Task visualizzato con l'id indicato (NULL = nessuno), in tempo costante per evento
+static parametri *cerca_locale(int id)
+{
+    for (unsigned int h = hash_id(id); indice_riga[h]; h = (h + 1) % INDICE_DIM)
+    {
+        parametri *tp = &locali[indice_riga[h] - 1];
+        if (tp->id == id)
+            return tp;
+    }
+    return NULL;
+}
+
+// Trasforma gli eventi letti in un lotto di notifiche con gli istanti del processo
+// real-time: la timeline e le durate dei job non dipendono dal ritardo del visualizzatore
+static void consuma_eventi(evring *r)
+{
+    evring_evento ev[EVENTI_PER_LETTURA];
+    bb_event lotto[EVENTI_PER_LETTURA];
+    int n;
+    do
+    {
+        n = evring_leggi(r, ev, EVENTI_PER_LETTURA);
+        int m = 0;
+        pthread_mutex_t *bloccato = NULL;
+        for (int k = 0; k < n; k++)
+        {
+            parametri *tp = cerca_locale(ev[k].task_id);
+            if (!tp)
+                continue;
+            bb_event *b = &lotto[m++];
+            memset(b, 0, sizeof(*b));
+            b->task_id = tp->id;
+            b->cpu = ev[k].cpu;
+            b->ts = ev[k].istante;
+            switch (ev[k].tipo)
+            {
+            case NOTIFICA_INIZIO:
+            {
+                b->type = BB_EVENT_START;
+                // at (prossima attivazione) serve al moto della pallina; il rilascio del
+                // job è at - periodo. Il mutex si riprende solo se cambia
+                pthread_mutex_t *mt = mutex_task(tp);
+                if (mt != bloccato)
+                {
+                    if (bloccato)
+                        pthread_mutex_unlock(bloccato);
+                    pthread_mutex_lock(mt);
+                    bloccato = mt;
+                }
+                tp->at = ev[k].at;
+                long long ril = (long long)ev[k].at.tv_sec * 1000000000LL + ev[k].at.tv_nsec
+                              - (long long)tp->periodo * 1000000LL;
+                b->release.tv_sec = ril / 1000000000LL;
+                b->release.tv_nsec = ril % 1000000000LL;
+                break;
+            }
+            case NOTIFICA_FINE:
+                b->type = BB_EVENT_END;
+                break;
+            case NOTIFICA_MISS:
+                b->type = BB_EVENT_MISS;
+                break;
+            }
+        }
+        if (bloccato)
+            pthread_mutex_unlock(bloccato);
+        bouncing_balls_notify_batch(lotto, m);
+    } while (n == EVENTI_PER_LETTURA);
+}
+
+// Ricrea la finestra per un nuovo processo real-time
+static bool riparti(void)
+{
+    bouncing_balls_shutdown();
+    memset(locali, 0, sizeof(locali));
+    memset(pallina, 0, sizeof(pallina));
+    memset(indice_riga, 0, sizeof(indice_riga));
+    if (!bouncing_balls_init(800, 600))
+        return false;
+    bouncing_balls_set_title("Visualizzatore");
+    al_start_timer(bouncing_balls_get_timer());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *nome = argc > 1 ? argv[1] : EVRING_NOME_DEFAULT;
+
+    // Il disegno non deve sottrarre CPU ai task real-time
+    if (setpriority(PRIO_PROCESS, 0, 10) != 0)
+        perror("setpriority");
+
+    evring *anello = collega(nome);
+    if (!riparti())
+    {
+        fprintf(stderr, "Errore inizializzazione libreria\n");
+        return 1;
+    }
+    sincronizza_task(anello);
+
+    printf("S = statistiche, T = timeline, L = livello di dettaglio, ESC = uscita\n");
+
+    bool running = true;
+    bool redraw = true;
+    bool show_stats = false;
+    bool show_timeline = false;
+    bouncing_balls_lod_mode lod = BB_LOD_AUTO;
+    long long persi = 0;
+    int frame = 0;
+    while (running)
+    {
+        ALLEGRO_EVENT ev;
+        al_wait_for_event(bouncing_balls_get_event_queue(), &ev);
+
+        if (ev.type == ALLEGRO_EVENT_DISPLAY_CLOSE)
+        {
+            running = false;
+        }
+        else if (ev.type == ALLEGRO_EVENT_KEY_DOWN)
+        {
+            if (ev.keyboard.keycode == ALLEGRO_KEY_S)
+            {
+                show_stats = !show_stats;
+                bouncing_balls_set_stats(show_stats);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_T)
+            {
+                show_timeline = !show_timeline;
+                bouncing_balls_set_timeline(show_timeline, 0);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_L)
+            {
+                lod = lod == BB_LOD_AUTO ? BB_LOD_BALLS : lod == BB_LOD_BALLS ? BB_LOD_DENSITY : BB_LOD_AUTO;
+                bouncing_balls_set_lod(lod, 0);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_ESCAPE)
+            {
+                running = false;
+            }
+        }
+        else if (ev.type == ALLEGRO_EVENT_DISPLAY_RESIZE)
+        {
+            al_acknowledge_resize(bouncing_balls_get_display());
+            bouncing_balls_resize(ev.display.width, ev.display.height);
+        }
+        else if (ev.type == ALLEGRO_EVENT_TIMER)
+        {
+            consuma_eventi(anello);
+            // Una volta al secondo: task nuovi, statistiche e riavvio del processo real-time
+            if (++frame % 60 == 0)
+            {
+                sincronizza_task(anello);
+                if (evring_persi(anello) != persi)
+                {
+                    persi = evring_persi(anello);
+                    printf("Eventi persi finora: %lld\n", persi);
+                }
+                if (!evring_produttore_attivo(anello))
+                {
+                    evring *nuovo = evring_apri(nome);
+                    if (nuovo && evring_incarnazione(nuovo) != evring_incarnazione(anello))
+                    {
+                        printf("Processo real-time riavviato (incarnazione %u)\n", evring_incarnazione(nuovo));
+                        evring_chiudi(anello);
+                        anello = nuovo;
+                        persi = 0;
+                        if (!riparti())
+                            break;
+                        bouncing_balls_set_stats(show_stats);
+                        bouncing_balls_set_timeline(show_timeline, 0);
+                        bouncing_balls_set_lod(lod, 0);
+                        sincronizza_task(anello);
+                    }
+                    else
+                    {
+                        evring_chiudi(nuovo);
+                        bouncing_balls_set_title("Visualizzatore - processo real-time terminato");
+                    }
+                }
+            }
+            bouncing_balls_update();
+            redraw = true;
+        }
+
+        if (redraw && al_is_event_queue_empty(bouncing_balls_get_event_queue()))
+        {
+            redraw = false;
+            bouncing_balls_draw();
+        }
+    }
+
+    evring_chiudi(anello);
+    bouncing_balls_shutdown();
+    return 0;
+}
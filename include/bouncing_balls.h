@@ -14,6 +14,17 @@
 #define BOUNCING_BALLS_VERSION_MINOR 0
 #define BOUNCING_BALLS_VERSION_PATCH 0
 
+// Modalità di livello di dettaglio del disegno
+typedef enum {
+    BB_LOD_AUTO,       // Palline singole sotto la soglia, mappa di densità sopra
+    BB_LOD_BALLS,      // Sempre palline singole
+    BB_LOD_DENSITY     // Sempre mappa di densità
+} bouncing_balls_lod_mode;
+
+// Contesto opaco: finestra, palline e stato di visualizzazione (bb_context è
+// dichiarato in time0.h). Le funzioni bouncing_balls_* operano sul contesto
+// predefinito; le funzioni bb_* accettano un contesto esplicito, NULL = predefinito
+
 // *** INIZIALIZZAZIONE E CLEANUP ***
 // Inizializza la libreria grafica e le strutture dati interne
 // screen_w, screen_h: dimensioni iniziali della finestra
@@ -22,9 +33,21 @@ bool bouncing_balls_init(int screen_w, int screen_h);
 // Libera tutte le risorse allocate dalla libreria
 void bouncing_balls_shutdown(void);
 
+// Restituisce il contesto predefinito (NULL prima di bouncing_balls_init)
+bb_context *bouncing_balls_default_context(void);
+
 // *** GESTIONE TASK/PALLINE ***
-// Aggiunge un nuovo task/pallina alla simulazione
-void bouncing_balls_add_task(parametri *params);
+// Handle di una pallina: identifica lo slot e la sua generazione, quindi smette di
+// essere valido quando la pallina viene rimossa, anche se lo slot viene riusato (0 = nessuna)
+typedef unsigned long long bb_handle;
+
+// Aggiunge un nuovo task/pallina alla simulazione (riusa gli slot liberati).
+// Ritorna l'handle della pallina (salvato anche in params->vis_handle), 0 se non c'è posto
+bb_handle bouncing_balls_add_task(parametri *params);
+
+// Rimuove la pallina (da chiamare dopo rimuove_task, quando il thread è terminato);
+// le notifiche che arrivano in ritardo per il task rimosso vengono ignorate
+void bouncing_balls_remove_task(bb_handle h);
 
 // Aggiorna la simulazione (posizione palline, stato, ecc.)
 void bouncing_balls_update(void);
@@ -32,6 +55,27 @@ void bouncing_balls_update(void);
 // Ridisegna la scena grafica (tutte le palline e overlay)
 void bouncing_balls_draw(void);
 
+// *** LIVELLO DI DETTAGLIO ***
+// Imposta la modalità LOD; threshold è il numero di task oltre cui BB_LOD_AUTO
+// passa alla mappa di densità (<= 0 lascia invariata la soglia, default 2000 o metà
+// della capacità MAX_BALLS se è più piccola; una soglia oltre la capacità vale MAX_BALLS)
+void bouncing_balls_set_lod(bouncing_balls_lod_mode mode, int threshold);
+
+// Imposta la zona (cerchio in pixel) in cui la mappa di densità lascia il posto
+// alle palline singole, es. sotto il mouse; radius <= 0 la disattiva
+void bouncing_balls_set_focus(int x, int y, int radius);
+
+// *** TIMELINE ***
+// Mostra/nasconde il diagramma di Gantt a scorrimento (una corsia per task con
+// rilasci, esecuzioni e deadline perse); window_ms > 0 imposta la finestra (default 10 s).
+// La timeline c'è solo nelle compilazioni con BB_STRUMENTI (strumenti.h)
+void bouncing_balls_set_timeline(bool visible, int window_ms);
+
+// *** STATISTICHE ***
+// Mostra/nasconde il pannello con esecuzioni, deadline perse, tempo di blocco
+// su risorse condivise (massimo per job e totale), modo di rilascio e jitter di ogni task
+void bouncing_balls_set_stats(bool visible);
+
 // *** GESTIONE EVENTI REAL-TIME ***
 // Notifica una deadline mancata per il task indicato (effetto visivo)
 void bouncing_balls_notify_deadline_miss(int task_id);
@@ -42,10 +86,41 @@ void bouncing_balls_notify_execution_start(int task_id);
 // Notifica la fine dell'esecuzione di un task
 void bouncing_balls_notify_execution_end(int task_id);
 
+// Evento con l'istante in cui è avvenuto, per chi notifica in differita o a lotti
+typedef enum {
+    BB_EVENT_START,             // Inizio esecuzione
+    BB_EVENT_END,               // Fine esecuzione
+    BB_EVENT_MISS               // Deadline persa
+} bb_event_type;
+
+typedef struct {
+    bb_event_type type;
+    int task_id;
+    int cpu;                    // CPU del task (-1 = sconosciuta)
+    struct timespec ts;         // CLOCK_MONOTONIC dell'evento ({0, 0} = istante di elaborazione)
+    struct timespec release;    // Solo BB_EVENT_START: rilascio del job ({0, 0} = at - periodo del task)
+    unsigned long long job;     // Numero di sequenza del job (0 = non fornito)
+} bb_event;
+
+// Varianti con l'istante CLOCK_MONOTONIC registrato dal chiamante (NULL = adesso) e il
+// numero del job: la timeline e la durata dei job (pannello statistiche) usano questi
+// istanti invece di quello di elaborazione; con job != 0 una fine viene accoppiata solo
+// all'inizio dello stesso job
+void bouncing_balls_notify_execution_start_at(int task_id, int cpu, const struct timespec *ts, unsigned long long job);
+void bouncing_balls_notify_execution_end_at(int task_id, int cpu, const struct timespec *ts, unsigned long long job);
+
+// Applica n eventi nell'ordine dato prendendo il mutex una volta ogni 256 eventi
+// (es. executor che completano molti job per risveglio). Ritorna gli eventi di task visualizzati
+int bouncing_balls_notify_batch(const bb_event *ev, int n);
+
 // *** CONFIGURAZIONE SCHEDULER ***
 // Imposta la politica di scheduling visualizzata (solo per overlay)
 void bouncing_balls_set_scheduler(schedulazione sched);
 
+// *** FISICA ***
+// Attiva/disattiva gli urti elastici tra palline (usa il campo massa, default: disattivi)
+void bouncing_balls_set_collisions(bool enabled);
+
 // *** GESTIONE FINESTRA ***
 // Gestisce il ridimensionamento della finestra grafica
 void bouncing_balls_resize(int new_w, int new_h);
@@ -70,6 +145,47 @@ ALLEGRO_COLOR bouncing_balls_get_task_color(int task_id);
 // Restituisce la versione della libreria come stringa
 const char* bouncing_balls_get_version(void);
 
+// *** API CON CONTESTO ESPLICITO ***
+// Crea un contesto indipendente con finestra, timer, coda eventi e mutex PI propri;
+// più contesti possono convivere nello stesso processo (NULL in caso di errore).
+// Il primo contesto registra la grafica come destinazione delle notifiche di time0, se
+// l'applicazione non ne ha già impostata un'altra; distrutto l'ultimo, la toglie
+bb_context *bb_context_create(int screen_w, int screen_h);
+
+// Distrugge un contesto; i task visualizzati devono essere già terminati (rimuove_task),
+// perché le loro notifiche passano da params->vis
+void bb_context_destroy(bb_context *ctx);
+
+// Equivalenti delle funzioni bouncing_balls_* sul contesto indicato.
+// bb_add_task lega il task al contesto (params->vis) e, se params->lock è NULL,
+// al suo mutex: va chiamata prima di crea_task
+bb_handle bb_add_task(bb_context *ctx, parametri *params);
+void bb_remove_task(bb_context *ctx, bb_handle h);
+void bb_update(bb_context *ctx);
+void bb_draw(bb_context *ctx);
+void bb_notify_deadline_miss(bb_context *ctx, int task_id);
+void bb_notify_execution_start(bb_context *ctx, int task_id);
+void bb_notify_execution_end(bb_context *ctx, int task_id);
+// Varianti per eventi prodotti in un altro thread o processo (es. letti da evring):
+// cpu è quella registrata dal task (-1 = sconosciuta) invece di sched_getcpu().
+// Le notifiche per id trovano la pallina con un indice hash, in tempo costante
+void bb_notify_execution_start_cpu(bb_context *ctx, int task_id, int cpu);
+void bb_notify_execution_end_cpu(bb_context *ctx, int task_id, int cpu);
+void bb_notify_execution_start_at(bb_context *ctx, int task_id, int cpu, const struct timespec *ts, unsigned long long job);
+void bb_notify_execution_end_at(bb_context *ctx, int task_id, int cpu, const struct timespec *ts, unsigned long long job);
+int bb_notify_batch(bb_context *ctx, const bb_event *ev, int n);
+void bb_set_scheduler(bb_context *ctx, schedulazione sched);
+void bb_set_collisions(bb_context *ctx, bool enabled);
+void bb_set_lod(bb_context *ctx, bouncing_balls_lod_mode mode, int threshold);
+void bb_set_focus(bb_context *ctx, int x, int y, int radius);
+void bb_set_timeline(bb_context *ctx, bool visible, int window_ms);
+void bb_set_stats(bb_context *ctx, bool visible);
+void bb_resize(bb_context *ctx, int new_w, int new_h);
+void bb_set_title(bb_context *ctx, const char *title);
+ALLEGRO_DISPLAY* bb_get_display(bb_context *ctx);
+ALLEGRO_EVENT_QUEUE* bb_get_event_queue(bb_context *ctx);
+ALLEGRO_TIMER* bb_get_timer(bb_context *ctx);
+
 // *** COMPATIBILITÀ (deprecate - usa le nuove API) ***
 // Macro per mantenere compatibilità con vecchi nomi delle funzioni
 #ifndef BOUNCING_BALLS_NO_LEGACY
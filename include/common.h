@@ -1,7 +1,7 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-#include <allegro5/allegro.h>  // Usa i mutex di Allegro per la sincronizzazione
+#include <pthread.h>  // Mutex POSIX con protocollo priority inheritance
 #include "time0.h"
 
 // Struttura per mappare task e parametri
@@ -11,7 +11,4 @@ typedef struct {
                         // (può essere un pthread_t o altro, a seconda della piattaforma)
 } task_bundle_t;
 
-// Mutex globale per sincronizzare l'accesso ai dati condivisi tra i task
-extern ALLEGRO_MUTEX *task_mutex;
-
 #endif // COMMON_H
\ No newline at end of file
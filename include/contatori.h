@@ -0,0 +1,30 @@
+#ifndef CONTATORI_H
+#define CONTATORI_H
+
+#include "time0.h"
+
+// *** CONTATORI DI PRESTAZIONI PER JOB ***
+// Strumento opzionale basato su perf_event_open: ogni thread dei task apre (al primo
+// job) un gruppo di contatori su se stesso (cicli, istruzioni, cache miss, migrazioni,
+// page fault) e li legge tutti con una sola read() all'inizio e alla fine di ogni job,
+// cioè tra il rilascio (set_period/attende_periodo) e deadline_miss: la stessa finestra
+// delle notifiche di inizio e fine esecuzione. I cambi di contesto volontari e
+// involontari vengono da getrusage(RUSAGE_THREAD). Le somme per task finiscono in
+// parametri.perf sotto il mutex del task. I contatori che il sistema non concede
+// (perf_event_paranoid, macchine virtuali) restano a zero.
+
+// Abilita/disabilita la misura (default disabilitata: nessun costo nei job). Nelle
+// compilazioni senza BB_STRUMENTI (strumenti.h) gli agganci non ci sono e resta disabilitata
+void contatori_abilita(int attivi);
+
+// Vero se la misura è abilitata
+int contatori_abilitati(void);
+
+// Chiamate da time0 nel thread del task all'inizio e alla fine di ogni job
+void contatori_inizio_job(parametri *tp);
+void contatori_fine_job(parametri *tp);
+
+// Stampa il riepilogo per task (medie per job) dei task con almeno un job misurato
+void contatori_stampa_riepilogo(parametri *tasks, int n);
+
+#endif // CONTATORI_H
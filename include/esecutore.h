@@ -0,0 +1,58 @@
+#ifndef ESECUTORE_H
+#define ESECUTORE_H
+
+#include <stddef.h>
+#include "time0.h"
+
+// *** ESECUTORE PERIODICO A COROUTINE ***
+// Alternativa leggera a crea_task: ogni task è una coroutine (ucontext) con uno stack
+// proprio preso da un pool di stack protetti da una pagina di guardia; al confine del
+// periodo la coroutine si sospende e torna al worker, un thread per core che riprende
+// le sue coroutine in ordine di rilascio (min-heap sulle attivazioni). Migliaia di task
+// periodici condividono così pochi thread e il cambio di contesto è uno swapcontext in
+// spazio utente invece di un risveglio del kernel.
+// Lo scheduling tra i task di un worker è cooperativo: un job non viene mai interrotto
+// da un altro task dello stesso worker, e il corpo non deve bloccarsi (risorse condivise,
+// I/O, sleep), altrimenti blocca tutti i task del worker. Politica e priorità sono quelle
+// del worker; il rilascio è sempre con sleep (attesa ignorata).
+// Notifiche, watchdog, contatori, riconfigura_task (solo i tempi) e termina_task
+// funzionano come per i task a thread; il watchdog segnala i miss ma le mitigazioni
+// sul thread (watchdog_degrada_priorita) non si applicano, perché il worker è condiviso.
+
+#define ESECUTORE_STACK_DEFAULT (64 * 1024)  // Stack di ogni coroutine (pagina di guardia esclusa)
+
+typedef struct esecutore esecutore;
+
+// Corpo di un task a coroutine: un ciclo di job chiuso da esecutore_attende_periodo
+typedef void (*corpo_task)(parametri *tp);
+
+// Crea num_worker worker (<= 0: uno per CPU della maschera di affinità del processo),
+// il worker k fissato sulla k-esima CPU della maschera, con politica sched e priorità
+// priorita (FIFO/RR richiedono i permessi: se mancano i worker partono con la politica
+// di default); i mutex interni sono a priority inheritance. dim_stack == 0:
+// ESECUTORE_STACK_DEFAULT. NULL in caso di errore
+esecutore *esecutore_crea(int num_worker, schedulazione sched, int priorita, size_t dim_stack);
+
+// Avvia tp come coroutine che esegue corpo. Il primo job parte a rilascio + offset se
+// rilascio è impostato, altrimenti subito (come set_period, che non va chiamata).
+// Il worker è quello meno carico (somma di wcet/periodo) tra quelli sulle CPU della
+// maschera affinita, o tra tutti se è vuota. Ritorna 0 oppure -1
+int esecutore_avvia_task(esecutore *e, corpo_task corpo, parametri *tp);
+
+// Dal corpo del task: sospende la coroutine fino al prossimo rilascio (come
+// attende_periodo, che viene chiamata al suo posto se il chiamante non è una coroutine:
+// lo stesso corpo può girare anche in un thread di crea_task dopo set_period).
+// Ritorna 0 per continuare con il nuovo job, 1 se è stata chiesta la terminazione
+int esecutore_attende_periodo(parametri *tp);
+
+// Chiede la terminazione del task (termina_task) e attende che la coroutine finisca;
+// lo stack torna nel pool e tp può essere riusato. Ritorna 0 oppure -1 (task sconosciuto)
+int esecutore_rimuove_task(esecutore *e, parametri *tp);
+
+// Cambi di contesto verso le coroutine eseguiti finora da tutti i worker
+long long esecutore_cambi_contesto(esecutore *e);
+
+// Termina tutti i task (al loro prossimo rilascio), ferma i worker e libera gli stack
+void esecutore_distrugge(esecutore *e);
+
+#endif // ESECUTORE_H
@@ -0,0 +1,82 @@
+#ifndef EVRING_H
+#define EVRING_H
+
+#include <time.h>
+#include "time0.h"
+
+// *** ANELLO DI EVENTI IN MEMORIA CONDIVISA (MODO A PROCESSI SEPARATI) ***
+// Il processo real-time scrive le notifiche dei task (inizio, fine, deadline persa)
+// in un anello di dimensione fissa in un segmento POSIX (shm_open); il visualizzatore
+// è un processo separato a priorità più bassa che si collega al segmento e le legge.
+// I produttori (i thread dei task e il watchdog) non si bloccano mai: riservano una
+// posizione con un incremento atomico e pubblicano lo slot con un numero di sequenza;
+// se il lettore resta indietro di più di un giro gli eventi più vecchi vengono
+// sovrascritti e contati come persi. Accanto all'anello c'è la tabella dei task
+// (parametri e statistiche), da cui il visualizzatore ricrea le palline.
+// Ciascun lato può essere riavviato senza l'altro: il lettore riparte dagli eventi
+// nuovi, e un nuovo processo real-time reinizializza il segmento incrementandone
+// l'incarnazione, che il visualizzatore usa per accorgersi del riavvio.
+// Questo modulo non usa Allegro: il processo real-time linka solo la parte time0.
+
+#define EVRING_NOME_DEFAULT "/bouncing_balls_eventi"
+#define EVRING_CAPACITA_DEFAULT 4096   // Slot dell'anello (arrotondati a una potenza di 2)
+#define EVRING_MAX_TASK 1024           // Righe della tabella dei task
+
+typedef struct evring evring;          // Collegamento al segmento (opaco, locale al processo)
+
+// Evento letto dall'anello
+typedef struct {
+    tipo_notifica tipo;
+    int task_id;
+    int cpu;                   // CPU del task al momento della notifica (-1 = sconosciuta)
+    struct timespec istante;   // CLOCK_MONOTONIC del produttore (confrontabile tra processi)
+    struct timespec at;        // Prossima attivazione del task al momento della notifica
+} evring_evento;
+
+// Lato real-time: crea il segmento (o reinizializza quello di un processo precedente)
+// con almeno capacita slot (<= 0: EVRING_CAPACITA_DEFAULT). NULL in caso di errore
+evring *evring_crea(const char *nome, int capacita);
+
+// Lato visualizzatore: si collega a un segmento esistente (NULL se non c'è o non è valido).
+// La lettura parte dagli eventi scritti dopo il collegamento
+evring *evring_apri(const char *nome);
+
+// Scollega il segmento dal processo (il segmento resta per l'altro lato)
+void evring_chiudi(evring *r);
+
+// Rimuove il nome del segmento (lato real-time, all'uscita)
+void evring_elimina(const char *nome);
+
+// Registra il task nella tabella (va chiamata prima di crea_task). Ritorna 0 oppure -1 (tabella piena)
+int evring_registra_task(evring *r, const parametri *tp);
+
+// Libera la riga del task (dopo rimuove_task): il visualizzatore ne toglie la pallina
+// e la riga può essere riusata da un task registrato in seguito
+void evring_rimuovi_task(evring *r, const parametri *tp);
+
+// Scrive una notifica del task senza prendere mutex; NOTIFICA_MISS aggiorna anche le
+// deadline perse nella riga della tabella, NOTIFICA_FINE tutta la riga (parametri
+// modificati con riconfigura_task, deadline perse, blocco, jitter). INIZIO e FINE vanno
+// scritti dal contesto del task (thread o coroutine), che è l'unico a modificarne i campi
+void evring_scrivi(evring *r, parametri *tp, tipo_notifica tipo);
+
+// Destinazione per time0_imposta_notifiche (utente = evring *)
+void evring_notifica(void *utente, parametri *tp, tipo_notifica tipo);
+
+// Legge fino a max eventi nell'ordine di pubblicazione. Ritorna il numero di eventi letti
+int evring_leggi(evring *r, evring_evento *ev, int max);
+
+// Eventi sovrascritti prima di essere letti da questo lettore
+long long evring_persi(const evring *r);
+
+// Incarnazione del segmento: cambia quando il processo real-time viene riavviato
+unsigned int evring_incarnazione(const evring *r);
+
+// Vero se il processo real-time che ha creato il segmento è ancora in vita
+int evring_produttore_attivo(const evring *r);
+
+// Copia in tp la riga i della tabella (id, periodo, deadline, priorita, sched, wcet e
+// statistiche). Ritorna 1 se la riga è occupata, 0 se è libera, -1 se i è fuori tabella
+int evring_task(const evring *r, int i, parametri *tp);
+
+#endif // EVRING_H
@@ -0,0 +1,54 @@
+#ifndef RISORSE_H
+#define RISORSE_H
+
+#include <pthread.h>
+#include "time0.h"
+
+// *** RISORSE CONDIVISE CON PROTOCOLLI DI ACCESSO ***
+// Le risorse proteggono sezioni critiche condivise tra task real-time evitando
+// l'inversione di priorità non limitata. Il tempo passato bloccati viene
+// accumulato nel job corrente del task e pubblicato in parametri
+// (blocco_max_ns, blocco_tot_ns) al confine del periodo.
+
+// Protocollo di accesso alla risorsa
+typedef enum {
+    PROTOCOLLO_PI,   // Priority Inheritance (PTHREAD_PRIO_INHERIT)
+    PROTOCOLLO_PCP,  // Priority Ceiling immediato (PTHREAD_PRIO_PROTECT)
+    PROTOCOLLO_SRP   // Stack Resource Policy: blocco all'inizio del job in base al ceiling di sistema
+} protocollo_risorsa;
+
+// Risorsa condivisa
+typedef struct {
+    pthread_mutex_t mutex;          // Mutex con il protocollo scelto
+    protocollo_risorsa protocollo;  // Protocollo di accesso
+    int ceiling;                    // Tetto: priorità (PCP) o livello di prelazione (SRP) massimo degli utenti
+} risorsa;
+
+// Inizializza una risorsa; per PCP ceiling è la priorità tetto (<= 0: massima di SCHED_FIFO),
+// per SRP il livello di prelazione tetto (<= 0: calcolato con risorsa_usata_da)
+// Ritorna 0 oppure il codice di errore pthread
+int risorsa_init(risorsa *r, protocollo_risorsa protocollo, int ceiling);
+
+// Dichiara che il task tp usa la risorsa: alza il ceiling alla sua priorità/livello.
+// Va chiamata prima che i task inizino ad usarla
+int risorsa_usata_da(risorsa *r, const parametri *tp);
+
+// Acquisisce la risorsa, misurando il tempo di blocco del task tp (tp può essere NULL)
+// Ritorna 0 oppure il codice di errore pthread
+int risorsa_lock(risorsa *r, parametri *tp);
+
+// Rilascia la risorsa
+void risorsa_unlock(risorsa *r);
+
+// Distrugge la risorsa
+void risorsa_distrugge(risorsa *r);
+
+// Livello di prelazione SRP del task: priorità per FIFO/RR, inversamente
+// proporzionale alla deadline relativa per OTHER/DEADLINE
+int livello_prelazione(const parametri *tp);
+
+// Chiamata da time0 all'inizio di ogni job: con risorse SRP occupate il job
+// attende finché il suo livello di prelazione non supera il ceiling di sistema
+void srp_inizio_job(parametri *tp);
+
+#endif // RISORSE_H
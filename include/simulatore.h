@@ -0,0 +1,99 @@
+#ifndef SIMULATORE_H
+#define SIMULATORE_H
+
+#include <time.h>
+#include "time0.h"
+
+// *** SIMULATORE A EVENTI DISCRETI (TEMPO VIRTUALE) ***
+// Esegue lo stesso task set usato dal run reale su num_cpu CPU virtuali, senza
+// thread né sleep: il tempo avanza da un evento al successivo (rilasci, fine dei job,
+// scadenza del quanto RR, esaurimento e ricarica del budget CBS), quindi un
+// iperperiodo di un'ora si verifica in pochi millisecondi.
+// Ogni job dura wcet * esecuzione_pct / 100; lo scheduling è globale (i task
+// possono migrare tra le CPU ammesse dalla maschera affinita).
+
+// Durata massima simulata quando durata_ms è 0 (iperperiodo troppo lungo)
+#define SIM_DURATA_MAX_MS (3600LL * 1000)
+
+// Politica simulata
+typedef enum {
+    SIM_PER_TASK,   // Ogni task usa il proprio campo sched (OTHER ≈ RR a priorità 0 con
+                    // fette di 3 ms come CFS, DEADLINE = CBS)
+    SIM_FIFO,       // Priorità fisse, FIFO a parità di priorità
+    SIM_RR,         // Priorità fisse, round robin con quanto quanto_ms a parità di priorità
+    SIM_EDF,        // Earliest Deadline First sulle deadline assolute dei job
+    SIM_CBS         // Come SCHED_DEADLINE: EDF su server CBS con runtime = wcet
+} sim_politica;
+
+// Tipi di evento: corrispondono a TIMELINE_RELEASE/EXEC_START/EXEC_END/MISS e alle
+// notifiche bouncing_balls_notify_* del run reale
+typedef enum {
+    SIM_RILASCIO,   // Rilascio di un job
+    SIM_INIZIO,     // Il task va in esecuzione su cpu (inizio job o ripresa dopo prelazione)
+    SIM_FINE,       // Il task lascia la cpu (fine job, prelazione o throttling CBS)
+    SIM_MISS        // Job terminato dopo la deadline (o non terminato a fine simulazione)
+} sim_evento_tipo;
+
+typedef struct {
+    sim_evento_tipo tipo;
+    int task_id;
+    int cpu;                   // CPU virtuale (-1 per rilasci e miss)
+    struct timespec istante;   // Tempo virtuale dall'inizio della simulazione
+    long long risposta_ns;     // SIM_FINE a job completato: tempo di risposta (0 altrimenti)
+    int deadline_ms;           // Deadline relativa del task (per normalizzare la risposta)
+} sim_evento;
+
+typedef void (*sim_callback)(const sim_evento *ev, void *utente);
+
+typedef struct {
+    int num_cpu;               // CPU virtuali (>= 1)
+    sim_politica politica;
+    int quanto_ms;             // Quanto RR (<= 0: 100 ms come Linux)
+    long long durata_ms;       // Durata simulata (0 = iperperiodo + offset massimo)
+    int esecuzione_pct;        // Durata dei job in percentuale del wcet (0 = 100)
+    const long long *wcet_ns;  // WCET di ogni task in ns, nello stesso ordine di tasks
+                               // (NULL o valore <= 0 = wcet del task in ms)
+    sim_callback evento;       // Chiamata per ogni evento, in ordine di tempo (può essere NULL)
+    void *utente;              // Passato a evento
+} sim_config;
+
+// Statistiche per task, nello stesso ordine dell'array tasks
+typedef struct {
+    int id;
+    long long job_rilasciati;
+    long long job_completati;
+    int deadperse;             // Come parametri.deadperse nel run reale
+    long long risposta_max_ns; // Tempo di risposta massimo (fine - rilascio)
+    long long risposta_tot_ns; // Somma dei tempi di risposta dei job completati
+    long long prelazioni;      // Volte in cui il task ha perso la CPU prima di finire il job
+    long long migrazioni;      // Ripartenze su una CPU diversa dalla precedente
+} sim_statistiche;
+
+// Iperperiodo del task set in millisecondi (mcm dei periodi), limitato a SIM_DURATA_MAX_MS
+long long sim_iperperiodo_ms(const parametri *tasks, int n);
+
+// Simula n task secondo cfg e riempie stat (n elementi).
+// I campi usati sono id, periodo, deadline, wcet (o cfg->wcet_ns), priorita, sched, affinita e offset;
+// tasks non viene modificato. Ritorna il numero totale di deadline perse, -1 se i
+// parametri non sono validi (periodo, deadline o wcet non positivi, num_cpu < 1)
+int simula(const parametri *tasks, int n, const sim_config *cfg, sim_statistiche *stat);
+
+// Durata simulata massima di un controllo di ammissione quando sim_insieme.durata_ms è 0:
+// il controllo gira in modo sincrono (spesso nel thread grafico) e non deve bloccarlo
+#define SIM_AMMISSIONE_DURATA_MS (10LL * 1000)
+
+// Task set per sim_ammissione
+typedef struct {
+    parametri *tasks;          // Task set in esecuzione (deve contenere il task da modificare)
+    int n;
+    int num_cpu;               // CPU simulate (>= 1)
+    long long durata_ms;       // Durata simulata massima (0 = SIM_AMMISSIONE_DURATA_MS)
+} sim_insieme;
+
+// Controllo di ammissione per riconfigura_task (utente = sim_insieme *): simula un
+// iperperiodo del task set con la modifica applicata a tp, ma non oltre la durata massima
+// (con iperperiodi più lunghi il controllo copre solo l'inizio), e la accetta (0) solo se
+// non ci sono deadline perse; ritorna 1 se la rifiuta, -1 se la simulazione non è possibile
+int sim_ammissione(const parametri *tp, const modifica_task *m, void *utente);
+
+#endif // SIMULATORE_H
@@ -0,0 +1,43 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <stdio.h>
+#include "time0.h"
+
+// *** RAMPA DI STRESS DELLA SCHEDULABILITÀ ***
+// Per ogni politica (OTHER, FIFO, RR, DEADLINE) genera insiemi di task casuali con
+// UUniFast a utilizzazione totale crescente e li esegue nel simulatore per un numero
+// fisso di iperperiodi. Per ogni livello registra la frazione di job con deadline persa,
+// gli insiemi senza miss e i percentili del tempo di risposta normalizzato (R / D), in
+// cui i job scaduti e mai finiti contano con risposta infinita; l'utilizzazione di
+// breakdown di una politica è quella effettiva (media di ΣC/T degli insiemi generati)
+// dell'ultimo livello in cui almeno metà degli insiemi non perde deadline.
+// I periodi sono scelti tra i divisori di 1000 ms (iperperiodo <= 1 s), le deadline
+// sono implicite, i WCET simulati sono in nanosecondi (un task piccolo non viene
+// arrotondato a 1 ms) e FIFO/RR usano priorità rate monotonic.
+
+typedef struct {
+    int num_task;              // Task per insieme (<= 0: 10)
+    int insiemi;               // Insiemi per livello di utilizzazione (<= 0: 20)
+    double u_min, u_max;       // Rampa di utilizzazione totale (u_max <= 0: num_cpu)
+    double passo;              // Incremento di utilizzazione (<= 0: 0.05 * num_cpu)
+    int num_cpu;               // CPU simulate (<= 0: CPU online)
+    int iperperiodi;           // Iperperiodi simulati per insieme (<= 0: 5)
+    unsigned int seme;         // Seme del generatore (stessa rampa a parità di seme)
+} stress_config;
+
+// Esegue la rampa per tutte le politiche. Scrive su csv una riga per politica e livello
+// (politica,utilizzazione,u_effettiva,insiemi,insiemi_ok,miss_ratio,non_finiti,r50,r95,r99,r_max;
+// non_finiti = job scaduti senza finire, che portano i percentili alti a inf)
+// e stampa su stdout l'utilizzazione di breakdown di ogni politica.
+// Ritorna 0 oppure -1 (memoria insufficiente)
+int stress_esegui(const stress_config *cfg, FILE *csv);
+
+// Genera con UUniFast (scartando i task con utilizzazione > 1) n task con
+// utilizzazione totale u, politica sched e priorità rate monotonic. Se wcet_ns non è
+// NULL vi scrive il WCET esatto di ogni task in ns (per sim_config.wcet_ns); wcet è
+// arrotondato per eccesso al millisecondo. Ritorna l'utilizzazione effettiva ΣC/T
+// (con i WCET in ns se wcet_ns non è NULL, altrimenti con quelli in ms)
+double stress_genera(parametri *tasks, long long *wcet_ns, int n, double u, schedulazione sched, unsigned int *seme);
+
+#endif // STRESS_H
@@ -0,0 +1,20 @@
+#ifndef STRUMENTI_H
+#define STRUMENTI_H
+
+// *** STRUMENTAZIONE DEL PERCORSO DEI JOB ***
+// Gli agganci di misura chiamati a ogni rilascio e a ogni evento (contatori di
+// prestazioni, statistiche del jitter di rilascio, tracciamento sulla timeline)
+// esistono solo se la libreria è compilata con BB_STRUMENTI, come nei profili debug
+// e instrumented del Makefile. Senza, STRUMENTO(...) diventa un blocco morto: il
+// compilatore controlla ancora gli argomenti ma li elimina, e nel binario non restano
+// né chiamate né controlli.
+
+#ifdef BB_STRUMENTI
+#define STRUMENTI_ATTIVI 1
+#define STRUMENTO(...) do { __VA_ARGS__; } while (0)
+#else
+#define STRUMENTI_ATTIVI 0
+#define STRUMENTO(...) do { if (0) { __VA_ARGS__; } } while (0)
+#endif
+
+#endif // STRUMENTI_H
@@ -0,0 +1,31 @@
+#ifndef TASKSET_H
+#define TASKSET_H
+
+#include <stddef.h>
+#include "time0.h"
+
+// *** CARICAMENTO DI TASK SET DA FILE ***
+// Formato: una riga per task, campi separati da spazi o tabulazioni,
+// righe vuote e commenti (da '#' a fine riga) ignorati:
+//
+//   # id  periodo  deadline  wcet  priorita  politica  affinita  offset
+//     1   100      100       10    50        FIFO      0         0
+//     2   200      150       20    40        RR        -1        5
+//
+// Tempi in millisecondi; politica tra OTHER, FIFO, RR, DEADLINE;
+// affinita = CPU su cui fissare il thread (-1 = nessuna);
+// offset = ritardo del primo rilascio rispetto all'istante di partenza comune.
+
+// Carica e valida l'intero task set prima di restituirlo: in caso di errore
+// non viene restituito nulla e err contiene file, riga e motivo.
+// Ritorna il numero di task caricati (in *tasks, da liberare con taskset_libera) oppure -1
+int taskset_carica(const char *percorso, parametri **tasks, char *err, size_t errlen);
+
+// Libera un task set restituito da taskset_carica
+void taskset_libera(parametri *tasks);
+
+// Imposta per tutti i task un istante di partenza comune (adesso + ritardo_ms):
+// ogni task rilascia il primo job a partenza + offset (istante critico se gli offset sono 0)
+void taskset_rilascio_sincrono(parametri *tasks, int n, int ritardo_ms);
+
+#endif // TASKSET_H
@@ -7,6 +7,40 @@
 // Enum per la politica di scheduling del task
 typedef enum { OTHER, FIFO, RR, DEADLINE } schedulazione;
 
+// Modo di attesa del rilascio in attende_periodo
+typedef enum {
+    RILASCIO_SLEEP,   // clock_nanosleep assoluto fino ad at (jitter = latenza di risveglio del kernel)
+    RILASCIO_IBRIDO   // Sleep fino ad at - margine, poi attesa attiva fino all'istante esatto
+} modo_rilascio;
+
+// Contatori di prestazioni sommati sui job del task (vedi contatori.h)
+typedef struct {
+    long long job;             // Job misurati
+    long long cicli, istruzioni, cache_miss;
+    long long cs_volontari, cs_involontari; // Cambi di contesto (attese / prelazioni)
+    long long migrazioni, page_fault;
+    long long cicli_max;       // Cicli del job più costoso
+} contatori_job;
+
+// Nuovi parametri temporali e di scheduling di un task in esecuzione (vedi riconfigura_task)
+typedef struct {
+    int periodo;               // Periodo in millisecondi (> 0)
+    int deadline;              // Deadline relativa in millisecondi (> 0)
+    int wcet;                  // Worst Case Execution Time (>= 0, <= deadline)
+    int priorita;              // Priorità (nell'intervallo della politica per FIFO/RR)
+    schedulazione sched;       // Politica di scheduling
+} modifica_task;
+
+// Contesto di visualizzazione (opaco, definito in bouncing_balls.c)
+typedef struct bb_context bb_context;
+
+// Notifiche inviate dai task alla parte grafica
+typedef enum {
+    NOTIFICA_INIZIO,  // Inizio esecuzione del job
+    NOTIFICA_FINE,    // Fine esecuzione del job
+    NOTIFICA_MISS     // Deadline persa
+} tipo_notifica;
+
 // Struttura che contiene tutti i parametri necessari per la gestione di un task periodico
 typedef struct 
 {
@@ -18,8 +52,49 @@ typedef struct
     schedulazione sched;       // Tipo di scheduling (OTHER, FIFO, RR)
     int deadperse;             // Numero di deadline perse
     int wcet;                  // Worst Case Execution Time (stima, opzionale)
+    long long blocco_job_ns;   // Tempo di blocco su risorse nel job corrente (solo thread del task)
+    long long blocco_max_ns;   // Massimo tempo di blocco su risorse in un singolo job
+    long long blocco_tot_ns;   // Tempo di blocco su risorse totale
+    unsigned long long affinita; // Maschera delle CPU ammesse (bit i = CPU i, 0 = nessun vincolo)
+    int offset;                // Ritardo del primo rilascio rispetto a rilascio, in millisecondi
+    int priorita_fissa;        // 1 = crea_task usa priorita così com'è, 0 = priorità casuale
+    struct timespec rilascio;  // Partenza sincrona comune (tv_sec == 0: parte subito)
+    pthread_mutex_t *lock;     // Mutex che protegge i parametri (NULL = time0_mutex())
+    bb_context *vis;           // Contesto grafico che visualizza il task (NULL = predefinito)
+    pthread_t thread;          // Thread del task (impostato da crea_task)
+    int thread_condiviso;      // 1 = task senza thread proprio (esecutore a coroutine)
+    modo_rilascio attesa;      // Modo di attesa del rilascio (default RILASCIO_SLEEP)
+    long long margine_ns;      // Margine di attesa attiva (ibrido), auto-regolato (solo thread del task)
+    long long latenza_ns;      // Stima della latenza di risveglio (solo thread del task)
+    long long jitter_max_ns;   // Ritardo massimo del rilascio effettivo rispetto ad at
+    long long jitter_tot_ns;   // Somma dei ritardi (media = jitter_tot_ns / rilasci)
+    long long rilasci;         // Rilasci misurati
+    contatori_job perf;        // Contatori di prestazioni (solo con contatori_abilita)
+    int termina;               // Terminazione richiesta (vedi termina_task)
+    unsigned long long vis_handle; // Pallina del task nel contesto vis (0 = nessuna, uso interno)
+    modifica_task modifica;    // Modifica in attesa del prossimo rilascio (uso interno)
+    int modifica_pendente;     // 1 = modifica da applicare al prossimo rilascio
+    int wd_indice;             // Posizione nel watchdog + 1 (0 = non armato, uso interno)
+    int wd_scattato;           // Il watchdog ha già segnalato il miss del job corrente
+    int degradato;             // Thread degradato dal watchdog: priorita ripristinata al prossimo rilascio
 } parametri;
 
+// Funzioni per la gestione dei mutex
+
+// Mutex predefinito (priority inheritance, creato al primo uso): protegge i
+// parametri dei task senza lock proprio ed è il mutex del contesto grafico predefinito
+pthread_mutex_t *time0_mutex(void);
+
+// Mutex che protegge i parametri del task (tp->lock oppure time0_mutex())
+pthread_mutex_t *mutex_task(parametri *tp);
+
+// Crea un mutex con protocollo PTHREAD_PRIO_INHERIT (NULL in caso di errore):
+// un thread che lo detiene eredita la priorità del task più urgente in attesa
+pthread_mutex_t *crea_mutex_pi(void);
+
+// Distrugge un mutex creato con crea_mutex_pi
+void distrugge_mutex(pthread_mutex_t *m);
+
 // Funzioni per la gestione del tempo
 
 // Confronta due istanti temporali (struct timespec)
@@ -35,15 +110,75 @@ void aggiunge_millisecondi(struct timespec *t, int ms);
 // Funzioni per la gestione dei task
 
 // Imposta il periodo iniziale e la deadline assoluta di un task
+// (con rilascio impostato attende prima l'istante rilascio + offset)
 void set_period(parametri *tp);
 
-// Attende fino al prossimo periodo del task (sleep assoluto)
-void attende_periodo(parametri *tp);
+// Attende fino al prossimo periodo del task (sleep assoluto oppure, con attesa
+// RILASCIO_IBRIDO, sleep fino a un margine auto-regolato e poi attesa attiva) e
+// registra il ritardo del rilascio in jitter_max_ns/jitter_tot_ns.
+// Ritorna 0 per continuare con il nuovo job, 1 se è stata chiesta la terminazione
+// del task (termina_task): il corpo del task deve allora uscire dal ciclo e ritornare
+int attende_periodo(parametri *tp);
+
+// Confine di rilascio per gli esecutori che attendono il rilascio da sé (esecutore.h):
+// applica la modifica di riconfigura_task in attesa (solo i tempi: politica e priorità
+// sono quelle del thread esecutore), pubblica blocco e ritardo del rilascio (ritardo_ns < 0:
+// non misurato), calcola at e dl del job rilasciato a rilascio e arma watchdog e contatori
+void time0_rilascio_job(parametri *tp, struct timespec rilascio, long long ritardo_ns);
+
+// Chiede al task di terminare: la richiesta viene vista da attende_periodo al
+// prossimo confine di rilascio (al più un periodo dopo), mai a metà di un job
+void termina_task(parametri *tp);
+
+// Chiede la terminazione del task e ne attende il thread (pthread_join); da non
+// chiamare dal task stesso. Dopo il ritorno tp può essere riusato.
+// Ritorna 0 oppure -1 (errore di pthread_join)
+int rimuove_task(parametri *tp);
+
+// Versione non bloccante di rimuove_task, dopo termina_task: se il thread del task è
+// già uscito lo raccoglie (pthread_tryjoin_np) e ritorna 0, e tp può essere riusato;
+// ritorna 1 se il task è ancora in esecuzione (da richiamare più tardi), -1 in caso di errore
+int raccoglie_task(parametri *tp);
 
 // Verifica se la deadline è stata mancata e notifica la parte grafica
+// (ritorna 1 anche se il miss era già stato segnalato dal watchdog, senza contarlo di nuovo)
 int deadline_miss(parametri *tp);
 
-// Crea un nuovo thread per il task, impostando la politica di scheduling e la priorità
+// Conta una deadline persa (deadperse) e la notifica alla parte grafica
+void segnala_deadline_persa(parametri *tp);
+
+// Destinazione delle notifiche: la grafica nello stesso processo (registrata da
+// bouncing_balls se non ce n'è già una) oppure l'anello in memoria condivisa verso un altro processo (evring.h)
+typedef void (*notifica_fn)(void *utente, parametri *tp, tipo_notifica tipo);
+
+// Imposta la destinazione delle notifiche (NULL = nessuna); va chiamata prima di creare i task
+void time0_imposta_notifiche(notifica_fn fn, void *utente);
+
+// Destinazione corrente delle notifiche (NULL = nessuna); se utente non è NULL vi scrive
+// il puntatore passato a time0_imposta_notifiche
+notifica_fn time0_notifiche(void **utente);
+
+// Invia una notifica del task alla destinazione corrente (dal thread del task)
+void notifica_task(parametri *tp, tipo_notifica tipo);
+
+// Controllo di ammissione per riconfigura_task: ritorna 0 se il task set resta
+// accettabile con tp modificato secondo m, > 0 se non lo è, < 0 se il controllo non è
+// possibile (es. sim_ammissione in simulatore.h)
+typedef int (*ammissione_fn)(const parametri *tp, const modifica_task *m, void *utente);
+
+// Cambia periodo, deadline, wcet, priorità e politica di un task in esecuzione.
+// La modifica viene registrata subito e applicata dal thread del task al prossimo
+// rilascio in attende_periodo (at e dl del job successivo usano i nuovi valori e la
+// politica viene reimpostata con pthread_setschedparam o sched_setattr); una seconda
+// chiamata prima del rilascio sostituisce la precedente. Con ammissione non NULL la
+// modifica viene prima sottoposta al controllo. I ceiling delle risorse non scendono:
+// se la priorità sale va ripetuto risorsa_usata_da.
+// Ritorna 0, -1 se i parametri non sono validi, -2 se il controllo di ammissione la rifiuta,
+// -3 se il controllo non è stato possibile (la modifica non viene registrata)
+int riconfigura_task(parametri *tp, const modifica_task *m, ammissione_fn ammissione, void *utente);
+
+// Crea un nuovo thread per il task, impostando la politica di scheduling, la priorità
+// e, se la maschera affinita non è vuota, le CPU su cui eseguirlo
 void crea_task(void *(*miotask)(void *), parametri *par);
 
 #endif // TIME0_H
@@ -0,0 +1,45 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_font.h>
+#include <stdbool.h>
+#include <time.h>
+
+// *** TIMELINE (DIAGRAMMA DI GANTT A SCORRIMENTO) ***
+// Una corsia per task con rilasci, intervalli di esecuzione e deadline perse
+// degli ultimi window_ms millisecondi. Il disegno vive in una bitmap persistente
+// che ad ogni frame viene traslata a sinistra: si disegnano solo i segmenti nuovi,
+// quindi il costo è proporzionale agli eventi arrivati e non alla finestra.
+// Le funzioni non sono thread-safe: il chiamante le protegge con il proprio mutex.
+
+// Tipi di evento registrati sulla timeline
+typedef enum {
+    TIMELINE_RELEASE,     // Rilascio di un job
+    TIMELINE_EXEC_START,  // Inizio esecuzione
+    TIMELINE_EXEC_END,    // Fine esecuzione
+    TIMELINE_MISS         // Deadline persa
+} timeline_event_type;
+
+typedef struct timeline timeline;
+
+// Crea una timeline con al più max_lanes corsie e una finestra di window_ms millisecondi
+timeline *timeline_create(int max_lanes, int window_ms);
+
+// Libera la timeline e le sue bitmap
+void timeline_destroy(timeline *tl);
+
+// Cambia la durata della finestra visualizzata (la storia già disegnata viene cancellata)
+void timeline_set_window(timeline *tl, int window_ms);
+
+// Registra un evento sulla corsia lane (task_id serve per l'etichetta della corsia)
+void timeline_record(timeline *tl, int lane, int task_id, timeline_event_type type, const struct timespec *ts);
+
+// Libera la corsia lane (task rimosso): perde l'etichetta e il segmento aperto,
+// la storia già disegnata scorre via con la finestra
+void timeline_release_lane(timeline *tl, int lane);
+
+// Disegna la timeline nel rettangolo (x, y, w, h) del target corrente all'istante now
+void timeline_draw(timeline *tl, ALLEGRO_FONT *font, int x, int y, int w, int h, const struct timespec *now);
+
+#endif // TIMELINE_H
@@ -0,0 +1,41 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "time0.h"
+
+// *** WATCHDOG DELLE DEADLINE ***
+// Un solo thread di monitoraggio con un heap delle deadline assolute dei job in
+// corso: dorme fino alla deadline più vicina e, se il job non è ancora finito,
+// segnala subito il miss (deadperse e notifica grafica) invece di aspettare che
+// deadline_miss venga chiamata a fine job. time0 arma il watchdog a ogni rilascio
+// (set_period, attende_periodo) e lo disarma in deadline_miss, che non conta due
+// volte un miss già segnalato. Armare e disarmare costa O(log n) con un solo timer
+// per tutti i task.
+
+// Chiamata dal thread del watchdog (fuori dai mutex) quando un job supera la
+// deadline senza essere terminato, ad esempio per degradarne la priorità
+typedef void (*watchdog_callback)(parametri *tp, void *utente);
+
+// Avvia il thread del watchdog (SCHED_FIFO alla massima priorità se permesso).
+// cb può essere NULL. Ritorna 0 oppure il codice di errore pthread
+int watchdog_avvia(watchdog_callback cb, void *utente);
+
+// Ferma il thread del watchdog e disarma tutti i task
+void watchdog_ferma(void);
+
+// Arma il watchdog sulla deadline corrente tp->dl (nessun effetto se non è avviato)
+void watchdog_arma(parametri *tp);
+
+// Disarma il watchdog per il job corrente di tp; se il watchdog sta segnalando il
+// miss di tp attende che abbia finito (quindi non va chiamata dalla callback).
+// Ritorna 1 se il watchdog aveva già segnalato il miss di questo job
+int watchdog_disarma(parametri *tp);
+
+// Callback di mitigazione pronta: porta il thread del task alla priorità minima
+// della sua politica (il job in ritardo non ruba più CPU agli altri task). Vale solo
+// per il job in ritardo: al rilascio successivo attende_periodo riporta il thread a
+// tp->priorita. I task dell'esecutore a coroutine, che non hanno un thread proprio,
+// vengono saltati
+void watchdog_degrada_priorita(parametri *tp, void *utente);
+
+#endif // WATCHDOG_H
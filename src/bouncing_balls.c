@@ -1,4 +1,4 @@
-#define _POSIX_C_SOURCE 199309L
+#define _GNU_SOURCE // sched_getcpu
 
 // Include delle librerie Allegro e standard
 #include <allegro5/allegro.h>
@@ -11,28 +11,30 @@
 #include <math.h>
 #include <pthread.h>
 #include <time.h>
+#include <sched.h>
+#include <unistd.h>
 #include "bouncing_balls.h"
 #include "time0.h"
+#include "timeline.h"
+#include "contatori.h"
+#include "strumenti.h"
 
 // *** DICHIARAZIONI FORWARD ***
 // Funzioni di utilità dichiarate in anticipo
-void draw_priority_groups(ALLEGRO_FONT *font, int window_w);
 void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, int x, int y, int max_width, const char *text);
 long bouncing_balls_diff_timespec_ms(struct timespec *a, struct timespec *b);
 
-// *** VARIABILI PRIVATE DELLA LIBRERIA ***
-extern ALLEGRO_MUTEX *task_mutex; // Mutex globale per sincronizzare accesso ai dati
-
 // Costanti fisiche per il movimento delle palline
 #define GRAVITY 0.3f           // Gravità applicata alle palline
 #define BOUNCE_ELASTICITY 0.9f // Elasticità del rimbalzo
+#define COLLISION_RESTITUTION 1.0f // Coefficiente di restituzione negli urti tra palline (1 = elastico)
 
 // Struttura che rappresenta una pallina/task
 typedef struct {
     float x, y;                // Posizione
     float vx, vy;              // Velocità
     float radius;              // Raggio
-    float mass;                // Massa (non usata direttamente)
+    float mass;                // Massa (usata negli urti tra palline)
     bool active;               // Pallina attiva
     ALLEGRO_COLOR color;       // Colore della pallina
     parametri *task_params;    // Puntatore ai parametri del task associato
@@ -43,35 +45,223 @@ typedef struct {
     bool executing;            // Indica se il task è in esecuzione
     int execution_count;       // Numero di esecuzioni completate
     float periodo_progress;    // Progresso nel periodo attuale (0-1)
+    int lod_cell;              // Cella della mappa di densità in cui è contata (-1 = nessuna)
+    int lod_state;             // Stato con cui è contata nella mappa di densità
+    int cpu;                   // CPU dell'ultima osservazione (-1 = mai eseguito)
+    int migrations;            // Cambi di CPU tra job consecutivi o durante un job
+    unsigned int generation;   // Generazione dello slot: cambia a ogni rimozione (handle scaduti)
+    int next_free;             // Prossimo slot libero nella free-list (-1 = fine)
+    int id_next;               // Slot + 1 della pallina successiva nello stesso secchio dell'indice (0 = fine)
+    int group_priority;        // Priorità con cui è nei gruppi di priorità in cache
+    long long exec_start_ns;   // Istante dell'ultimo inizio di esecuzione
+    unsigned long long exec_job; // Numero del job iniziato (0 = non fornito)
+    bool exec_open;            // Inizio ricevuto, fine non ancora
+    long long exec_max_ns;     // Durata massima misurata (inizio-fine dello stesso job)
+    long long exec_tot_ns;     // Somma delle durate misurate
+    long long exec_measured;   // Job con durata misurata
+    bool drawn;                // Disegnata nel back buffer della scena
+    float drawn_x, drawn_y;    // Posizione con cui è stata disegnata
+    float drawn_extent;        // Metà lato del riquadro occupato quando è stata disegnata
+    unsigned int drawn_look;   // Aspetto (overlay, esecuzione, CPU, lampeggio) disegnato
 } Ball;
 
-// Variabili globali per la gestione delle palline e della finestra
-#define MAX_BALLS 100
+// Costanti per la gestione delle palline e della finestra
+#ifndef MAX_BALLS
+#define MAX_BALLS 4096         // Capacità: il Makefile la passa con -DMAX_BALLS (make MAX_BALLS=...)
+#endif
 #define BALL_RADIUS 20
 
-static Ball balls[MAX_BALLS];              // Array delle palline
-static int num_balls = 0;                  // Numero di palline attive
-static int screen_w = 800, screen_h = 600; // Dimensioni finestra
-static ALLEGRO_FONT* font = NULL;          // Font per il testo
-static ALLEGRO_DISPLAY *display = NULL;    // Display Allegro
-static ALLEGRO_EVENT_QUEUE *event_queue = NULL; // Coda eventi
-static ALLEGRO_TIMER *timer = NULL;        // Timer principale
-static bool initialized = false;           // Flag di inizializzazione
-static int total_deadline_misses = 0;      // Conteggio globale deadline miss
-
-// Variabili per tracciare l'esecuzione dei task
-static int currently_executing_task = -1;  // ID del task in esecuzione (-1 = nessuno)
-static int total_executions = 0;           // Numero totale di esecuzioni
-static int executions_per_task[MAX_BALLS] = {0}; // Esecuzioni per ogni task
-
-// Variabili per overlay dei task eseguiti di recente
+// Indice id del task -> slot: secchi concatenati, almeno due per pallina
+#define ID_INDEX_SIZE (2 * MAX_BALLS)
+
+// Corsie per CPU (sotto il terreno)
+#define MAX_CPU_LANES 256
+
+// Costanti per overlay dei task eseguiti di recente
 #define MAX_EXECUTION_HISTORY 10
-static int recent_executions[MAX_EXECUTION_HISTORY]; // ID dei task eseguiti di recente
-static int recent_execution_count = 0;               // Quanti task nella storia
+
+// Eventi applicati da bb_notify_batch per ogni acquisizione del mutex
+#define BB_BATCH_LOCK_EVENTS 256
 
 // Ottimizzazione aggiornamenti
 #define UPDATE_FREQUENCY_DIVIDER 3
 
+// Costanti per le collisioni tra palline
+// Broad phase: griglia uniforme ricostruita ad ogni passo con un counting sort (tempo lineare)
+// Narrow phase: coppie candidate raccolte in array SoA e testate in un ciclo senza salti
+#define GRID_MAX_CELLS 16384                // Numero massimo di celle della griglia
+#define MAX_COLLISION_PAIRS 4096            // Dimensione del lotto di coppie candidate
+
+// Costanti per il livello di dettaglio (LOD)
+// Sopra la soglia le palline sono aggregate in una mappa di densità a celle, aggiornata
+// in modo incrementale: solo le celle in cui una pallina entra, esce o cambia stato
+// vengono ridisegnate nella texture, quindi il costo del frame non dipende dal numero di task
+#define LOD_CELL_SIZE 8                     // Lato di una cella della mappa di densità in pixel
+// Soglia predefinita di task per passare alla mappa: 2000, ma sempre raggiungibile con MAX_BALLS
+#define LOD_DEFAULT_THRESHOLD (MAX_BALLS / 2 < 2000 ? MAX_BALLS / 2 : 2000)
+#define LOD_SATURATION 4                    // Palline per cella che danno la piena intensità
+#define LOD_FOCUS_MAX 256                   // Massimo di palline disegnate nella zona di fuoco
+enum { LOD_STATE_IDLE, LOD_STATE_EXECUTING, LOD_STATE_MISSED, LOD_NUM_STATES };
+
+// Costanti per il disegno a regioni sporche
+// La scena (sfondo, testo in alto, gruppi di priorità, terreno, palline, corsie CPU) vive in
+// un back buffer persistente; ad ogni frame si ridisegnano solo le piastrelle toccate dai
+// riquadri vecchi e nuovi delle palline che sono cambiate e dai testi/corsie modificati,
+// poi il buffer viene copiato sulla finestra con un solo blit. Timeline e pannello delle
+// statistiche cambiano ad ogni frame e sono disegnati sopra la copia
+#define DIRTY_TILE_SIZE 32                  // Lato di una piastrella della mappa sporca in pixel
+#define SCENE_BACKGROUND al_map_rgb(16, 16, 32)
+
+// Costanti per la timeline (Gantt a scorrimento, una corsia per pallina)
+#define TIMELINE_DEFAULT_WINDOW_MS 10000
+
+// Contesto di visualizzazione: tutto lo stato che prima era globale nella libreria.
+// Ogni contesto ha palline, mutex, finestra, timer e coda eventi propri,
+// quindi contesti diversi non condividono nulla
+struct bb_context {
+    pthread_mutex_t *lock;                  // Mutex del contesto (priority inheritance)
+    bool owns_lock;                         // Il mutex va distrutto con il contesto
+
+    Ball balls[MAX_BALLS];                  // Array delle palline
+    int num_balls;                          // Slot usati finora (attivi o nella free-list)
+    int active_balls;                       // Numero di palline attive
+    int free_head;                          // Primo slot libero riusabile (-1 = nessuno)
+    int id_index[ID_INDEX_SIZE];            // Slot + 1 della prima pallina di ogni secchio (0 = vuoto)
+    int screen_w, screen_h;                 // Dimensioni finestra
+    ALLEGRO_FONT* font;                     // Font per il testo
+    ALLEGRO_DISPLAY *display;               // Display Allegro
+    ALLEGRO_EVENT_QUEUE *event_queue;       // Coda eventi
+    ALLEGRO_TIMER *timer;                   // Timer principale
+    int total_deadline_misses;              // Conteggio globale deadline miss
+    schedulazione current_scheduler;        // Politica di scheduling corrente (overlay)
+
+    // Variabili per tracciare l'esecuzione dei task
+    int cpu_running[MAX_CPU_LANES];         // Task in esecuzione su ogni CPU (-1 = nessuno)
+    int num_cpus;                           // CPU mostrate nelle corsie
+    int total_executions;                   // Numero totale di esecuzioni
+    int executions_per_task[MAX_BALLS];     // Esecuzioni per ogni task
+
+    // Variabili per overlay dei task eseguiti di recente
+    int recent_executions[MAX_EXECUTION_HISTORY]; // ID dei task eseguiti di recente
+    int recent_execution_count;                   // Quanti task nella storia
+
+    // Variabili per le collisioni tra palline
+    bool collisions_enabled;                // Urti tra palline attivi
+    int grid_cols, grid_rows;               // Dimensioni della griglia in celle
+    float grid_cell_size;                   // Lato di una cella in pixel
+    int grid_cell_start[GRID_MAX_CELLS + 1]; // Inizio di ogni cella in grid_items
+    int grid_items[MAX_BALLS];              // Indici delle palline ordinati per cella
+    int ball_cell[MAX_BALLS];               // Cella di ogni pallina (-1 = fuori griglia)
+    float pos_x[MAX_BALLS], pos_y[MAX_BALLS], pos_r[MAX_BALLS]; // Copie SoA per la narrow phase
+    int pair_a[MAX_COLLISION_PAIRS], pair_b[MAX_COLLISION_PAIRS]; // Coppie candidate
+    unsigned char pair_hit[MAX_COLLISION_PAIRS];                  // Esito del test di sovrapposizione
+    int pair_count;
+
+    // Variabili per il livello di dettaglio (LOD)
+    bouncing_balls_lod_mode lod_mode;       // Modalità LOD richiesta
+    int lod_threshold;                      // Soglia per BB_LOD_AUTO
+    bool lod_density_active;                // Mappa di densità in uso nel frame corrente
+    bool lod_rebuild;                       // Ricostruzione completa necessaria (attivazione/resize)
+    int lod_cols, lod_rows;                 // Dimensioni della mappa in celle
+    unsigned short *lod_counts;             // Contatori per cella e stato [cella * LOD_NUM_STATES + stato]
+    int *lod_dirty;                         // Celle da ridisegnare nella texture
+    unsigned char *lod_dirty_flag;          // Evita duplicati in lod_dirty
+    int lod_dirty_count;
+    bool lod_texture_stale;                 // La texture va ridisegnata per intero
+    ALLEGRO_BITMAP *lod_bitmap;             // Texture della mappa (una cella = un pixel)
+    int focus_x, focus_y, focus_radius;     // Zona di fuoco (palline singole)
+    int focus_balls[LOD_FOCUS_MAX];         // Palline dentro la zona di fuoco
+    int focus_count;
+
+    // Timeline e pannello delle statistiche
+    timeline *task_timeline;                // Timeline alimentata dalle notifiche
+    bool timeline_visible;                  // Timeline disegnata (e registrata) o no
+    bool stats_visible;                     // Pannello delle statistiche per task
+
+    // Disegno a regioni sporche
+    ALLEGRO_BITMAP *scene;                  // Back buffer persistente della scena
+    unsigned char *dirty_tiles;             // Piastrelle da ridisegnare [riga * dirty_cols + colonna]
+    int dirty_cols, dirty_rows;
+    int dirty_count;                        // Piastrelle segnate in dirty_tiles
+    bool scene_invalid;                     // Ridisegno completo al prossimo frame
+    char drawn_info[200];                   // Testo informativo presente nella scena
+    char drawn_groups[1024];                // Gruppi di priorità presenti nella scena
+    int drawn_groups_bottom;                // Fine verticale del testo dei gruppi disegnato
+    int drawn_cpu_running[MAX_CPU_LANES];   // Task delle corsie CPU presenti nella scena
+    bool backbuffer_kept;                   // Swap per copia: il backbuffer conserva il frame precedente
+    bool present_stale;                     // Il backbuffer non coincide con la scena (overlay, densità)
+    bool present_all;                       // Scena ridisegnata per intero in questo frame
+
+    // Dati derivati dall'insieme dei task, ricostruiti solo quando cambia: il costo del
+    // frame non cresce con il numero di task fermi
+    char groups_text[1024];                 // Gruppi di priorità (build_priority_groups)
+    bool groups_stale;                      // Task aggiunti/rimossi, priorità o politica cambiate
+    int draw_order[MAX_BALLS + MAX_EXECUTION_HISTORY]; // Palline attive per slot, poi i recenti
+    int draw_base_count;                    // Palline attive all'inizio di draw_order
+    bool draw_order_stale;                  // Palline aggiunte o rimosse
+};
+
+// *** VARIABILI PRIVATE DELLA LIBRERIA ***
+static bb_context *default_ctx = NULL;     // Contesto usato dalle funzioni bouncing_balls_*
+static int allegro_users = 0;              // Contesti che usano gli addon Allegro
+static pthread_mutex_t allegro_users_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Risolve il contesto: NULL indica il contesto predefinito
+static bb_context *resolve(bb_context *ctx) {
+    return ctx ? ctx : default_ctx;
+}
+
+static bool build_priority_groups(bb_context *ctx, char *buf, size_t size);
+static int priority_groups_top(bb_context *ctx);
+static void draw_priority_groups(bb_context *ctx, const char *groups);
+static int wrap_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, int x, int y, int max_width, const char *text, bool draw);
+static void mark_dirty(bb_context *ctx, float x0, float y0, float x1, float y1);
+static void lod_mark_dirty(bb_context *ctx, int cell);
+
+// Handle di una pallina: generazione nei 32 bit alti, slot + 1 in quelli bassi
+static bb_handle make_handle(int slot, unsigned int generation) {
+    return ((bb_handle)generation << 32) | (unsigned int)(slot + 1);
+}
+
+// Slot della pallina indicata dall'handle, -1 se è stata rimossa (o lo slot è stato riusato)
+static int handle_slot(bb_context *ctx, bb_handle h) {
+    long slot = (long)(h & 0xffffffffu) - 1;
+    if (slot < 0 || slot >= ctx->num_balls) return -1;
+    Ball *b = &ctx->balls[slot];
+    if (!b->active || b->generation != (unsigned int)(h >> 32)) return -1;
+    return (int)slot;
+}
+
+// Secchio dell'indice per l'id di un task (hash moltiplicativo: id consecutivi si sparpagliano)
+static int id_bucket(int task_id) {
+    return (int)(((unsigned int)task_id * 2654435761u) % ID_INDEX_SIZE);
+}
+
+// Inserisce la pallina dello slot nell'indice per id
+static void index_ball(bb_context *ctx, int slot) {
+    int bucket = id_bucket(ctx->balls[slot].task_params->id);
+    ctx->balls[slot].id_next = ctx->id_index[bucket];
+    ctx->id_index[bucket] = slot + 1;
+}
+
+// Toglie la pallina dello slot dall'indice per id
+static void unindex_ball(bb_context *ctx, int slot) {
+    int *link = &ctx->id_index[id_bucket(ctx->balls[slot].task_params->id)];
+    while (*link && *link != slot + 1)
+        link = &ctx->balls[*link - 1].id_next;
+    if (*link) *link = ctx->balls[slot].id_next;
+    ctx->balls[slot].id_next = 0;
+}
+
+// Slot della pallina attiva del task task_id (-1 = nessuna), dall'indice per id
+static int find_ball(bb_context *ctx, int task_id) {
+    for (int k = ctx->id_index[id_bucket(task_id)]; k; k = ctx->balls[k - 1].id_next) {
+        if (ctx->balls[k - 1].task_params->id == task_id)
+            return k - 1;
+    }
+    return -1;
+}
+
 // Funzione per generare un colore unico per ogni task
 ALLEGRO_COLOR bouncing_balls_get_task_color(int id) {
     float hue = (id * 67) % 360;
@@ -90,126 +280,380 @@ ALLEGRO_COLOR bouncing_balls_get_task_color(int id) {
     return al_map_rgb((r+m)*255, (g+m)*255, (b+m)*255);
 }
 
-// Notifica una deadline miss per un task (fa lampeggiare la pallina)
-void bouncing_balls_notify_deadline_miss(int task_id) {
-    al_lock_mutex(task_mutex);
-    total_deadline_misses++;
-    for (int i = 0; i < num_balls; i++) {
-        if (balls[i].active && balls[i].task_params && balls[i].task_params->id == task_id) {
-            balls[i].dead_flashes = 4; // 4 lampeggi
-            balls[i].flash_counter = 0;
-            break;
-        }
-    }
-    al_unlock_mutex(task_mutex);
+// Istante dell'evento: quello registrato da chi lo ha prodotto o, se manca, adesso
+static struct timespec event_time(const bb_event *ev) {
+    struct timespec ts = ev->ts;
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0)
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts;
 }
 
-// Notifica l'inizio dell'esecuzione di un task (cambia stato e overlay)
-void bouncing_balls_notify_execution_start(int task_id) {
-    al_lock_mutex(task_mutex);
-    currently_executing_task = task_id;
-    total_executions++;
+static long long timespec_to_ns(struct timespec t) {
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Deadline persa sulla pallina i (-1 = nessuna pallina), con il mutex del contesto acquisito
+static void deadline_miss_locked(bb_context *ctx, int i, const bb_event *ev) {
+    ctx->total_deadline_misses++;
+    if (i < 0) return;
+    ctx->balls[i].dead_flashes = 4; // 4 lampeggi
+    ctx->balls[i].flash_counter = 0;
+    STRUMENTO(if (ctx->timeline_visible) {
+        struct timespec ts = event_time(ev);
+        timeline_record(ctx->task_timeline, i, ev->task_id, TIMELINE_MISS, &ts);
+    });
+}
+
+// Inizio esecuzione sulla pallina i (-1 = nessuna pallina), con il mutex del contesto acquisito
+static void execution_start_locked(bb_context *ctx, int i, const bb_event *ev) {
+    int task_id = ev->task_id, cpu = ev->cpu;
+    if (cpu >= 0 && cpu < ctx->num_cpus)
+        ctx->cpu_running[cpu] = task_id;
+    ctx->total_executions++;
     // Aggiorna la lista dei task eseguiti di recente (overlay)
-    for (int i = 0; i < recent_execution_count; i++) {
-        if (recent_executions[i] == task_id) {
-            for (int j = i; j < recent_execution_count - 1; j++)
-                recent_executions[j] = recent_executions[j + 1];
-            recent_execution_count--;
+    for (int k = 0; k < ctx->recent_execution_count; k++) {
+        if (ctx->recent_executions[k] == task_id) {
+            for (int j = k; j < ctx->recent_execution_count - 1; j++)
+                ctx->recent_executions[j] = ctx->recent_executions[j + 1];
+            ctx->recent_execution_count--;
             break;
         }
     }
-    if (recent_execution_count == MAX_EXECUTION_HISTORY) {
-        for (int i = MAX_EXECUTION_HISTORY - 1; i > 0; i--)
-            recent_executions[i] = recent_executions[i - 1];
+    if (ctx->recent_execution_count == MAX_EXECUTION_HISTORY) {
+        for (int k = MAX_EXECUTION_HISTORY - 1; k > 0; k--)
+            ctx->recent_executions[k] = ctx->recent_executions[k - 1];
     } else {
-        for (int i = recent_execution_count; i > 0; i--)
-            recent_executions[i] = recent_executions[i - 1];
-        recent_execution_count++;
+        for (int k = ctx->recent_execution_count; k > 0; k--)
+            ctx->recent_executions[k] = ctx->recent_executions[k - 1];
+        ctx->recent_execution_count++;
     }
-    recent_executions[0] = task_id;
+    ctx->recent_executions[0] = task_id;
+    if (i < 0) return;
     // Aggiorna stato della pallina
-    for (int i = 0; i < num_balls; i++) {
-        if (balls[i].active && balls[i].task_params && balls[i].task_params->id == task_id) {
-            balls[i].executing = true;
-            balls[i].execution_count++;
-            executions_per_task[i]++;
-            break;
+    Ball *b = &ctx->balls[i];
+    // Una riconfigurazione diventa visibile dal primo job rilasciato dopo la modifica
+    if (b->task_params->priorita != b->group_priority) {
+        b->group_priority = b->task_params->priorita;
+        ctx->groups_stale = true;
+    }
+    b->executing = true;
+    b->execution_count++;
+    if (b->cpu >= 0 && cpu >= 0 && cpu != b->cpu)
+        b->migrations++;
+    b->cpu = cpu;
+    ctx->executions_per_task[i]++;
+    // Inizio dell'intervallo di esecuzione, chiuso dall'evento di fine dello stesso job
+    struct timespec now = event_time(ev);
+    b->exec_start_ns = timespec_to_ns(now);
+    b->exec_job = ev->job;
+    b->exec_open = true;
+    STRUMENTO(if (ctx->timeline_visible) {
+        // Senza rilascio esplicito è at - periodo (at è già la prossima attivazione)
+        struct timespec release = ev->release;
+        if (release.tv_sec == 0 && release.tv_nsec == 0) {
+            long long rel_ns = timespec_to_ns(b->task_params->at)
+                             - (long long)b->task_params->periodo * 1000000LL;
+            release.tv_sec = rel_ns / 1000000000LL;
+            release.tv_nsec = rel_ns % 1000000000LL;
+        }
+        timeline_record(ctx->task_timeline, i, task_id, TIMELINE_RELEASE, &release);
+        timeline_record(ctx->task_timeline, i, task_id, TIMELINE_EXEC_START, &now);
+    });
+}
+
+// Fine esecuzione sulla pallina i (-1 = nessuna pallina), con il mutex del contesto acquisito
+static void execution_end_locked(bb_context *ctx, int i, const bb_event *ev) {
+    int task_id = ev->task_id, cpu = ev->cpu;
+    // Libera lo slot della CPU solo se nessun altro task lo ha occupato nel frattempo
+    for (int c = 0; c < ctx->num_cpus; c++)
+        if (ctx->cpu_running[c] == task_id)
+            ctx->cpu_running[c] = -1;
+    if (i < 0) return;
+    Ball *b = &ctx->balls[i];
+    b->executing = false;
+    if (b->cpu >= 0 && cpu >= 0 && cpu != b->cpu)
+        b->migrations++;
+    if (cpu >= 0)
+        b->cpu = cpu;
+    struct timespec now = event_time(ev);
+    // Durata del job: solo se l'inizio è dello stesso job (un inizio perso non la falsa)
+    if (b->exec_open && (ev->job == 0 || ev->job == b->exec_job)) {
+        long long d = timespec_to_ns(now) - b->exec_start_ns;
+        if (d >= 0) {
+            if (d > b->exec_max_ns) b->exec_max_ns = d;
+            b->exec_tot_ns += d;
+            b->exec_measured++;
         }
     }
-    al_unlock_mutex(task_mutex);
+    b->exec_open = false;
+    STRUMENTO(if (ctx->timeline_visible)
+        timeline_record(ctx->task_timeline, i, task_id, TIMELINE_EXEC_END, &now));
+}
+
+// Applica un evento alla pallina i, con il mutex del contesto acquisito
+static void apply_event_locked(bb_context *ctx, int i, const bb_event *ev) {
+    switch (ev->type) {
+    case BB_EVENT_START: execution_start_locked(ctx, i, ev); break;
+    case BB_EVENT_END: execution_end_locked(ctx, i, ev); break;
+    case BB_EVENT_MISS: deadline_miss_locked(ctx, i, ev); break;
+    }
+}
+
+// Applica un evento al task ev->task_id (un lock per evento)
+static void notify_one(bb_context *ctx, const bb_event *ev) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    apply_event_locked(ctx, find_ball(ctx, ev->task_id), ev);
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Notifica una deadline miss per un task (fa lampeggiare la pallina)
+void bb_notify_deadline_miss(bb_context *ctx, int task_id) {
+    bb_event ev = {BB_EVENT_MISS, task_id, -1, {0, 0}, {0, 0}, 0};
+    clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    notify_one(ctx, &ev);
+}
+
+// Notifica l'inizio dell'esecuzione di un task (cambia stato e overlay)
+void bb_notify_execution_start(bb_context *ctx, int task_id) {
+    // Chiamata dal thread del task: CPU su cui parte il job, istante prima del lock
+    bb_notify_execution_start_at(ctx, task_id, sched_getcpu(), NULL, 0);
+}
+
+// Come bb_notify_execution_start, con la CPU registrata da chi ha prodotto l'evento
+void bb_notify_execution_start_cpu(bb_context *ctx, int task_id, int cpu) {
+    bb_event ev = {BB_EVENT_START, task_id, cpu, {0, 0}, {0, 0}, 0};
+    notify_one(ctx, &ev);
+}
+
+// Come bb_notify_execution_start_cpu, con l'istante (NULL = adesso) e il numero del job
+void bb_notify_execution_start_at(bb_context *ctx, int task_id, int cpu, const struct timespec *ts, unsigned long long job) {
+    bb_event ev = {BB_EVENT_START, task_id, cpu, {0, 0}, {0, 0}, job};
+    if (ts) ev.ts = *ts;
+    else clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    notify_one(ctx, &ev);
 }
 
 // Notifica la fine dell'esecuzione di un task
-void bouncing_balls_notify_execution_end(int task_id) {
-    al_lock_mutex(task_mutex);
-    if (currently_executing_task == task_id)
-        currently_executing_task = -1;
-    for (int i = 0; i < num_balls; i++) {
-        if (balls[i].active && balls[i].task_params && balls[i].task_params->id == task_id) {
-            balls[i].executing = false;
-            break;
+void bb_notify_execution_end(bb_context *ctx, int task_id) {
+    // Una CPU diversa dall'inizio indica una migrazione durante il job
+    bb_notify_execution_end_at(ctx, task_id, sched_getcpu(), NULL, 0);
+}
+
+// Come bb_notify_execution_end, con la CPU registrata da chi ha prodotto l'evento
+void bb_notify_execution_end_cpu(bb_context *ctx, int task_id, int cpu) {
+    bb_event ev = {BB_EVENT_END, task_id, cpu, {0, 0}, {0, 0}, 0};
+    notify_one(ctx, &ev);
+}
+
+// Come bb_notify_execution_end_cpu, con l'istante (NULL = adesso) e il numero del job
+void bb_notify_execution_end_at(bb_context *ctx, int task_id, int cpu, const struct timespec *ts, unsigned long long job) {
+    bb_event ev = {BB_EVENT_END, task_id, cpu, {0, 0}, {0, 0}, job};
+    if (ts) ev.ts = *ts;
+    else clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    notify_one(ctx, &ev);
+}
+
+// Applica n eventi in ordine prendendo il mutex una volta per lotto di BB_BATCH_LOCK_EVENTS
+// (il disegno non resta bloccato dietro lotti molto lunghi)
+int bb_notify_batch(bb_context *ctx, const bb_event *ev, int n) {
+    ctx = resolve(ctx);
+    if (!ctx || !ev) return 0;
+    int applied = 0;
+    for (int base = 0; base < n; base += BB_BATCH_LOCK_EVENTS) {
+        int end = n - base < BB_BATCH_LOCK_EVENTS ? n : base + BB_BATCH_LOCK_EVENTS;
+        int last_id = 0, last_slot = -1;
+        bool have_last = false;
+        pthread_mutex_lock(ctx->lock);
+        for (int k = base; k < end; k++) {
+            // Gli eventi dello stesso task arrivano spesso di seguito (inizio, fine);
+            // anche un id sconosciuto resta in memoria e non viene cercato di nuovo
+            if (!have_last || ev[k].task_id != last_id) {
+                have_last = true;
+                last_id = ev[k].task_id;
+                last_slot = find_ball(ctx, last_id);
+            }
+            apply_event_locked(ctx, last_slot, &ev[k]);
+            if (last_slot >= 0) applied++;
         }
+        pthread_mutex_unlock(ctx->lock);
     }
-    al_unlock_mutex(task_mutex);
+    return applied;
 }
 
-// Inizializza la libreria grafica e le risorse Allegro
-bool bouncing_balls_init(int w, int h) {
-    if (initialized) return true;
-    if (!al_init()) return false;
-    if (!al_init_primitives_addon()) return false;
-    if (!al_install_keyboard()) return false;
-    if (!al_init_font_addon()) return false;
-    if (!al_init_ttf_addon()) return false;
+// Destinazione delle notifiche di time0 nello stesso processo: la pallina del task,
+// trovata in O(1) dall'handle; se il task è stato rimosso la notifica viene scartata
+static void notifica_locale(void *utente, parametri *tp, tipo_notifica tipo) {
+    (void)utente;
+    bb_context *ctx = resolve(tp->vis);
+    if (!ctx) return;
+    // Istante e CPU si leggono prima del lock: un'attesa sul mutex non sposta l'evento
+    bb_event ev = {BB_EVENT_MISS, tp->id, -1, {0, 0}, {0, 0}, 0};
+    if (tipo != NOTIFICA_MISS) {
+        ev.type = tipo == NOTIFICA_INIZIO ? BB_EVENT_START : BB_EVENT_END;
+        ev.cpu = sched_getcpu();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    bb_handle h = __atomic_load_n(&tp->vis_handle, __ATOMIC_RELAXED);
+    pthread_mutex_lock(ctx->lock);
+    int i = handle_slot(ctx, h);
+    if (i >= 0)
+        apply_event_locked(ctx, i, &ev);
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Inizializza (una volta per processo) Allegro e gli addon usati dai contesti
+static bool acquire_allegro(void) {
+    bool ok = true;
+    pthread_mutex_lock(&allegro_users_mutex);
+    if (allegro_users == 0) {
+        ok = al_init() && al_init_primitives_addon() && al_install_keyboard() &&
+             al_install_mouse() && al_init_font_addon() && al_init_ttf_addon();
+        if (ok) srand(time(NULL));
+    }
+    if (ok) allegro_users++;
+    pthread_mutex_unlock(&allegro_users_mutex);
+    return ok;
+}
+
+// Chiude gli addon Allegro quando l'ultimo contesto viene distrutto
+static void release_allegro(void) {
+    pthread_mutex_lock(&allegro_users_mutex);
+    if (--allegro_users == 0) {
+        al_shutdown_font_addon();
+        al_shutdown_ttf_addon();
+        al_shutdown_primitives_addon();
+    }
+    pthread_mutex_unlock(&allegro_users_mutex);
+}
+
+// Crea un contesto con mutex PI proprio (lock == NULL) oppure con il mutex indicato
+static bb_context *create_context(int w, int h, pthread_mutex_t *lock) {
+    bb_context *ctx = calloc(1, sizeof(bb_context));
+    if (!ctx) return NULL;
+    if (!acquire_allegro()) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->lock = lock ? lock : crea_mutex_pi();
+    ctx->owns_lock = lock == NULL;
+    if (!ctx->lock) {
+        release_allegro();
+        free(ctx);
+        return NULL;
+    }
+    ctx->screen_w = w;
+    ctx->screen_h = h;
+    ctx->current_scheduler = OTHER;
+    ctx->num_cpus = (int)sysconf(_SC_NPROCESSORS_CONF);
+    if (ctx->num_cpus < 1) ctx->num_cpus = 1;
+    if (ctx->num_cpus > MAX_CPU_LANES) ctx->num_cpus = MAX_CPU_LANES;
+    for (int c = 0; c < MAX_CPU_LANES; c++)
+        ctx->cpu_running[c] = -1;
+    ctx->free_head = -1;
+    ctx->grid_cell_size = 2 * BALL_RADIUS;
+    ctx->lod_mode = BB_LOD_AUTO;
+    ctx->lod_threshold = LOD_DEFAULT_THRESHOLD;
+    ctx->lod_rebuild = true;
+    ctx->lod_texture_stale = true;
     al_set_new_display_flags(ALLEGRO_RESIZABLE);
-    screen_w = w;
-    screen_h = h;
-    display = al_create_display(w, h);
-    if (!display) return false;
-    event_queue = al_create_event_queue();
-    if (!event_queue) { al_destroy_display(display); return false; }
-    timer = al_create_timer(1.0 / 60.0); // 60 FPS
-    if (!timer) { al_destroy_event_queue(event_queue); al_destroy_display(display); return false; }
-    al_register_event_source(event_queue, al_get_keyboard_event_source());
-    al_register_event_source(event_queue, al_get_timer_event_source(timer));
-    al_register_event_source(event_queue, al_get_display_event_source(display));
-    font = al_create_builtin_font();
-    initialized = true;
-    srand(time(NULL));
-    return true;
+    // Con lo swap per copia il backbuffer resta valido dopo il flip e basta copiarvi le
+    // regioni cambiate; con il page flipping il suo contenuto è indefinito (copia completa)
+    al_set_new_display_option(ALLEGRO_SWAP_METHOD, 1, ALLEGRO_SUGGEST);
+    ctx->display = al_create_display(w, h);
+    ctx->backbuffer_kept = ctx->display && al_get_display_option(ctx->display, ALLEGRO_SWAP_METHOD) == 1;
+    ctx->present_stale = true;
+    ctx->event_queue = ctx->display ? al_create_event_queue() : NULL;
+    ctx->timer = ctx->event_queue ? al_create_timer(1.0 / 60.0) : NULL; // 60 FPS
+    if (!ctx->timer) {
+        bb_context_destroy(ctx);
+        return NULL;
+    }
+    al_register_event_source(ctx->event_queue, al_get_keyboard_event_source());
+    al_register_event_source(ctx->event_queue, al_get_mouse_event_source());
+    al_register_event_source(ctx->event_queue, al_get_timer_event_source(ctx->timer));
+    al_register_event_source(ctx->event_queue, al_get_display_event_source(ctx->display));
+    ctx->font = al_create_builtin_font();
+    // La timeline è uno strumento: senza BB_STRUMENTI non si crea e resta nascosta
+    ctx->task_timeline = STRUMENTI_ATTIVI ? timeline_create(MAX_BALLS, TIMELINE_DEFAULT_WINDOW_MS) : NULL;
+    // La grafica riceve le notifiche solo se l'applicazione non ha scelto un'altra destinazione
+    // (es. evring_notifica); ogni task viene poi smistato al proprio contesto da tp->vis
+    if (time0_notifiche(NULL) == NULL)
+        time0_imposta_notifiche(notifica_locale, NULL);
+    return ctx;
 }
 
-// Libera tutte le risorse allocate dalla libreria
-void bouncing_balls_shutdown(void) {
-    if (font) al_destroy_font(font);
-    if (timer) al_destroy_timer(timer);
-    if (event_queue) al_destroy_event_queue(event_queue);
-    if (display) al_destroy_display(display);
-    al_shutdown_font_addon();
-    al_shutdown_ttf_addon();
-    al_shutdown_primitives_addon();
-    initialized = false;
+// Crea un nuovo contesto indipendente (finestra, timer, coda eventi e mutex propri)
+bb_context *bb_context_create(int w, int h) {
+    return create_context(w, h, NULL);
 }
 
-// Funzioni di accesso alle risorse Allegro
-ALLEGRO_DISPLAY* bouncing_balls_get_display(void) { return display; }
-ALLEGRO_EVENT_QUEUE* bouncing_balls_get_event_queue(void) { return event_queue; }
-ALLEGRO_TIMER* bouncing_balls_get_timer(void) { return timer; }
+// Distrugge un contesto e tutte le sue risorse
+void bb_context_destroy(bb_context *ctx) {
+    if (!ctx) return;
+    timeline_destroy(ctx->task_timeline);
+    if (ctx->lod_bitmap) al_destroy_bitmap(ctx->lod_bitmap);
+    if (ctx->scene) al_destroy_bitmap(ctx->scene);
+    free(ctx->dirty_tiles);
+    free(ctx->lod_counts);
+    free(ctx->lod_dirty);
+    free(ctx->lod_dirty_flag);
+    if (ctx->font) al_destroy_font(ctx->font);
+    if (ctx->timer) al_destroy_timer(ctx->timer);
+    if (ctx->event_queue) al_destroy_event_queue(ctx->event_queue);
+    if (ctx->display) al_destroy_display(ctx->display);
+    if (ctx->owns_lock) distrugge_mutex(ctx->lock);
+    if (ctx == default_ctx) default_ctx = NULL;
+    free(ctx);
+    release_allegro();
+    // Senza contesti la grafica smette di essere la destinazione delle notifiche
+    pthread_mutex_lock(&allegro_users_mutex);
+    if (allegro_users == 0 && time0_notifiche(NULL) == notifica_locale)
+        time0_imposta_notifiche(NULL, NULL);
+    pthread_mutex_unlock(&allegro_users_mutex);
+}
+
+// Funzioni di accesso alle risorse Allegro di un contesto
+ALLEGRO_DISPLAY* bb_get_display(bb_context *ctx) { ctx = resolve(ctx); return ctx ? ctx->display : NULL; }
+ALLEGRO_EVENT_QUEUE* bb_get_event_queue(bb_context *ctx) { ctx = resolve(ctx); return ctx ? ctx->event_queue : NULL; }
+ALLEGRO_TIMER* bb_get_timer(bb_context *ctx) { ctx = resolve(ctx); return ctx ? ctx->timer : NULL; }
 
 // Aggiunge una nuova pallina/task alla simulazione
-void bouncing_balls_add_task(parametri *params) {
-    if (num_balls >= MAX_BALLS || !params) return;
-    al_lock_mutex(task_mutex);
-    Ball* b = &balls[num_balls];
+bb_handle bb_add_task(bb_context *ctx, parametri *params) {
+    ctx = resolve(ctx);
+    if (!ctx) return 0;
+    if (!params) return 0;
+    pthread_mutex_lock(ctx->lock);
+    // Prima gli slot liberati da bb_remove_task (O(1), senza compattare l'array)
+    int slot = ctx->free_head;
+    if (slot >= 0) {
+        ctx->free_head = ctx->balls[slot].next_free;
+    } else if (ctx->num_balls < MAX_BALLS) {
+        slot = ctx->num_balls++;
+        ctx->balls[slot].generation = 1;
+    } else {
+        pthread_mutex_unlock(ctx->lock);
+        return 0;
+    }
+    // I parametri del task sono protetti dal mutex del contesto in cui è visualizzato
+    if (!params->lock) params->lock = ctx->lock;
+    params->vis = ctx;
+    Ball* b = &ctx->balls[slot];
+    unsigned int generation = b->generation;
     memset(b, 0, sizeof(Ball));
+    b->generation = generation;
+    b->next_free = -1;
     b->radius = BALL_RADIUS;
     b->mass = 1.0f;
     b->active = true;
     b->color = bouncing_balls_get_task_color(params->id);
     b->task_params = params;
-    float ground_level = screen_h * 0.9f;
+    b->group_priority = params->priorita;
+    index_ball(ctx, slot);
+    float ground_level = ctx->screen_h * 0.9f;
     float ground_position = ground_level - BALL_RADIUS;
-    b->x = b->radius + (rand() % (int)(screen_w - 2 * b->radius));
+    b->x = b->radius + (rand() % (int)(ctx->screen_w - 2 * b->radius));
     b->y = ground_position;
     b->vx = 1.0f;
     float periodo_factor = fminf(params->periodo / 1000.0f, 1.0f);
@@ -220,28 +664,362 @@ void bouncing_balls_add_task(parametri *params) {
     b->execution_count = 0;
     b->ready = false;
     b->periodo_progress = 0.0f;
-    num_balls++;
-    al_unlock_mutex(task_mutex);
+    b->lod_cell = -1;
+    b->cpu = -1;
+    ctx->executions_per_task[slot] = 0;
+    ctx->active_balls++;
+    ctx->groups_stale = true;
+    ctx->draw_order_stale = true;
+    bb_handle h = make_handle(slot, generation);
+    __atomic_store_n(&params->vis_handle, h, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(ctx->lock);
+    return h;
+}
+
+// Rimuove la pallina indicata dall'handle; lo slot torna nella free-list con una
+// nuova generazione, così gli handle vecchi e le notifiche in ritardo vengono ignorati
+void bb_remove_task(bb_context *ctx, bb_handle h) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    int slot = handle_slot(ctx, h);
+    if (slot < 0) {
+        pthread_mutex_unlock(ctx->lock);
+        return;
+    }
+    Ball *b = &ctx->balls[slot];
+    int task_id = b->task_params->id;
+    if (__atomic_load_n(&b->task_params->vis_handle, __ATOMIC_RELAXED) == h)
+        __atomic_store_n(&b->task_params->vis_handle, 0, __ATOMIC_RELAXED);
+    // Toglie la pallina da mappa di densità, corsie CPU, overlay dei recenti e timeline
+    if (b->lod_cell >= 0 && !ctx->lod_rebuild && ctx->lod_counts) {
+        ctx->lod_counts[b->lod_cell * LOD_NUM_STATES + b->lod_state]--;
+        lod_mark_dirty(ctx, b->lod_cell);
+    }
+    for (int c = 0; c < ctx->num_cpus; c++)
+        if (ctx->cpu_running[c] == task_id)
+            ctx->cpu_running[c] = -1;
+    for (int k = 0; k < ctx->recent_execution_count; k++) {
+        if (ctx->recent_executions[k] == task_id) {
+            for (int j = k; j < ctx->recent_execution_count - 1; j++)
+                ctx->recent_executions[j] = ctx->recent_executions[j + 1];
+            ctx->recent_execution_count--;
+            break;
+        }
+    }
+    timeline_release_lane(ctx->task_timeline, slot);
+    unindex_ball(ctx, slot);
+    if (b->drawn)
+        mark_dirty(ctx, b->drawn_x - b->drawn_extent, b->drawn_y - b->drawn_extent,
+                   b->drawn_x + b->drawn_extent, b->drawn_y + b->drawn_extent);
+    b->drawn = false;
+    b->active = false;
+    b->task_params = NULL;
+    b->executing = false;
+    b->lod_cell = -1;
+    if (++b->generation == 0) b->generation = 1; // 0 renderebbe nullo l'handle
+    b->next_free = ctx->free_head;
+    ctx->free_head = slot;
+    ctx->active_balls--;
+    ctx->groups_stale = true;
+    ctx->draw_order_stale = true;
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Ricostruisce la griglia uniforme (counting sort delle palline per cella)
+// Le dimensioni sono ricalcolate ad ogni passo, quindi seguono bouncing_balls_resize
+static void build_collision_grid(bb_context *ctx) {
+    ctx->grid_cell_size = 2 * BALL_RADIUS;
+    ctx->grid_cols = (int)ceilf(ctx->screen_w / ctx->grid_cell_size);
+    ctx->grid_rows = (int)ceilf(ctx->screen_h / ctx->grid_cell_size);
+    if (ctx->grid_cols < 1) ctx->grid_cols = 1;
+    if (ctx->grid_rows < 1) ctx->grid_rows = 1;
+    if (ctx->grid_cols * ctx->grid_rows > GRID_MAX_CELLS) {
+        // Finestra molto grande: celle più larghe per restare nel limite
+        ctx->grid_cell_size = ceilf(sqrtf((float)ctx->screen_w * ctx->screen_h / GRID_MAX_CELLS)) + 1;
+        ctx->grid_cols = (int)ceilf(ctx->screen_w / ctx->grid_cell_size);
+        ctx->grid_rows = (int)ceilf(ctx->screen_h / ctx->grid_cell_size);
+    }
+    int num_cells = ctx->grid_cols * ctx->grid_rows;
+    memset(ctx->grid_cell_start, 0, (num_cells + 1) * sizeof(int));
+    for (int i = 0; i < ctx->num_balls; i++) {
+        Ball* b = &ctx->balls[i];
+        if (!b->active || !b->task_params) {
+            ctx->ball_cell[i] = -1;
+            continue;
+        }
+        int cx = (int)(b->x / ctx->grid_cell_size);
+        int cy = (int)(b->y / ctx->grid_cell_size);
+        cx = cx < 0 ? 0 : (cx >= ctx->grid_cols ? ctx->grid_cols - 1 : cx);
+        cy = cy < 0 ? 0 : (cy >= ctx->grid_rows ? ctx->grid_rows - 1 : cy);
+        ctx->ball_cell[i] = cy * ctx->grid_cols + cx;
+        ctx->grid_cell_start[ctx->ball_cell[i] + 1]++;
+        ctx->pos_x[i] = b->x;
+        ctx->pos_y[i] = b->y;
+        ctx->pos_r[i] = b->radius;
+    }
+    for (int c = 0; c < num_cells; c++)
+        ctx->grid_cell_start[c + 1] += ctx->grid_cell_start[c];
+    // ctx->grid_cell_start[c] viene usato come cursore e poi ripristinato
+    for (int i = 0; i < ctx->num_balls; i++) {
+        if (ctx->ball_cell[i] >= 0)
+            ctx->grid_items[ctx->grid_cell_start[ctx->ball_cell[i]]++] = i;
+    }
+    for (int c = num_cells; c > 0; c--)
+        ctx->grid_cell_start[c] = ctx->grid_cell_start[c - 1];
+    ctx->grid_cell_start[0] = 0;
+}
+
+// Narrow phase su un lotto di coppie: test di sovrapposizione vettorizzabile,
+// poi risoluzione dell'urto elastico (impulso lungo la normale) solo per le coppie a contatto
+static void flush_collision_pairs(bb_context *ctx) {
+    for (int k = 0; k < ctx->pair_count; k++) {
+        float dx = ctx->pos_x[ctx->pair_b[k]] - ctx->pos_x[ctx->pair_a[k]];
+        float dy = ctx->pos_y[ctx->pair_b[k]] - ctx->pos_y[ctx->pair_a[k]];
+        float rs = ctx->pos_r[ctx->pair_a[k]] + ctx->pos_r[ctx->pair_b[k]];
+        ctx->pair_hit[k] = (dx * dx + dy * dy) < rs * rs;
+    }
+    for (int k = 0; k < ctx->pair_count; k++) {
+        if (!ctx->pair_hit[k]) continue;
+        int ia = ctx->pair_a[k], ib = ctx->pair_b[k];
+        Ball *a = &ctx->balls[ia], *b = &ctx->balls[ib];
+        float dx = ctx->pos_x[ib] - ctx->pos_x[ia];
+        float dy = ctx->pos_y[ib] - ctx->pos_y[ia];
+        float dist = sqrtf(dx * dx + dy * dy);
+        // Le correzioni delle coppie precedenti spostano le palline: il test del lotto
+        // può essere superato, e una coppia già separata non va riavvicinata
+        float overlap = ctx->pos_r[ia] + ctx->pos_r[ib] - dist;
+        if (overlap <= 0) continue;
+        float nx, ny;
+        if (dist > 1e-4f) {
+            nx = dx / dist;
+            ny = dy / dist;
+        } else {
+            nx = 1.0f; // Palline coincidenti: separa lungo x
+            ny = 0.0f;
+        }
+        float inv_ma = 1.0f / a->mass, inv_mb = 1.0f / b->mass;
+        float rel = (b->vx - a->vx) * nx + (b->vy - a->vy) * ny;
+        if (rel < 0) {
+            float j = -(1.0f + COLLISION_RESTITUTION) * rel / (inv_ma + inv_mb);
+            a->vx -= j * inv_ma * nx;
+            a->vy -= j * inv_ma * ny;
+            b->vx += j * inv_mb * nx;
+            b->vy += j * inv_mb * ny;
+        }
+        // Correzione di posizione: separa le palline in proporzione alle masse
+        float share = overlap / (inv_ma + inv_mb);
+        a->x -= share * inv_ma * nx;
+        a->y -= share * inv_ma * ny;
+        b->x += share * inv_mb * nx;
+        b->y += share * inv_mb * ny;
+        ctx->pos_x[ia] = a->x; ctx->pos_y[ia] = a->y;
+        ctx->pos_x[ib] = b->x; ctx->pos_y[ib] = b->y;
+    }
+    ctx->pair_count = 0;
+}
+
+// Accoda tutte le coppie tra la cella c e la cella vicina n (n == c: coppie interne)
+static void collect_cell_pairs(bb_context *ctx, int c, int n) {
+    for (int p = ctx->grid_cell_start[c]; p < ctx->grid_cell_start[c + 1]; p++) {
+        int q0 = (n == c) ? p + 1 : ctx->grid_cell_start[n];
+        for (int q = q0; q < ctx->grid_cell_start[n + 1]; q++) {
+            if (ctx->pair_count == MAX_COLLISION_PAIRS)
+                flush_collision_pairs(ctx);
+            ctx->pair_a[ctx->pair_count] = ctx->grid_items[p];
+            ctx->pair_b[ctx->pair_count] = ctx->grid_items[q];
+            ctx->pair_count++;
+        }
+    }
+}
+
+// Urti tra palline: ogni cella viene confrontata con sé stessa e con metà dei vicini
+// (destra, sotto-sinistra, sotto, sotto-destra) così ogni coppia è considerata una volta
+static void resolve_ball_collisions(bb_context *ctx) {
+    build_collision_grid(ctx);
+    ctx->pair_count = 0;
+    for (int cy = 0; cy < ctx->grid_rows; cy++) {
+        for (int cx = 0; cx < ctx->grid_cols; cx++) {
+            int c = cy * ctx->grid_cols + cx;
+            if (ctx->grid_cell_start[c] == ctx->grid_cell_start[c + 1]) continue;
+            collect_cell_pairs(ctx, c, c);
+            if (cx + 1 < ctx->grid_cols) collect_cell_pairs(ctx, c, c + 1);
+            if (cy + 1 < ctx->grid_rows) {
+                if (cx > 0) collect_cell_pairs(ctx, c, c + ctx->grid_cols - 1);
+                collect_cell_pairs(ctx, c, c + ctx->grid_cols);
+                if (cx + 1 < ctx->grid_cols) collect_cell_pairs(ctx, c, c + ctx->grid_cols + 1);
+            }
+        }
+    }
+    flush_collision_pairs(ctx);
+    // Dopo la separazione mantiene le palline dentro la finestra e sopra il terreno
+    float ground_position = ctx->screen_h * 0.9f - BALL_RADIUS;
+    for (int i = 0; i < ctx->num_balls; i++) {
+        Ball* b = &ctx->balls[i];
+        if (ctx->ball_cell[i] < 0) continue;
+        b->x = fminf(fmaxf(b->x, b->radius), ctx->screen_w - b->radius);
+        if (b->y > ground_position) b->y = ground_position;
+    }
+}
+
+// Stato di una pallina ai fini della mappa di densità
+static int ball_lod_state(const Ball *b) {
+    if (b->dead_flashes > 0) return LOD_STATE_MISSED;
+    if (b->executing) return LOD_STATE_EXECUTING;
+    return LOD_STATE_IDLE;
+}
+
+// Segna una cella della mappa come da ridisegnare
+static void lod_mark_dirty(bb_context *ctx, int cell) {
+    if (ctx->lod_dirty_flag[cell]) return;
+    ctx->lod_dirty_flag[cell] = 1;
+    ctx->lod_dirty[ctx->lod_dirty_count++] = cell;
+}
+
+// (Ri)alloca la mappa di densità per le dimensioni correnti della finestra
+static bool lod_allocate(bb_context *ctx) {
+    int cols = (ctx->screen_w + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE;
+    int rows = (ctx->screen_h + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE;
+    int cells = cols * rows;
+    unsigned short *counts = calloc((size_t)cells * LOD_NUM_STATES, sizeof(unsigned short));
+    int *dirty = malloc((size_t)cells * sizeof(int));
+    unsigned char *dirty_flag = calloc((size_t)cells, 1);
+    if (!counts || !dirty || !dirty_flag) {
+        free(counts);
+        free(dirty);
+        free(dirty_flag);
+        return false;
+    }
+    free(ctx->lod_counts);
+    free(ctx->lod_dirty);
+    free(ctx->lod_dirty_flag);
+    ctx->lod_counts = counts;
+    ctx->lod_dirty = dirty;
+    ctx->lod_dirty_flag = dirty_flag;
+    ctx->lod_cols = cols;
+    ctx->lod_rows = rows;
+    ctx->lod_dirty_count = 0;
+    return true;
+}
+
+// Aggiorna in modo incrementale la mappa di densità e la lista della zona di fuoco
+static void update_lod(bb_context *ctx) {
+    bool want = ctx->lod_mode == BB_LOD_DENSITY || (ctx->lod_mode == BB_LOD_AUTO && ctx->active_balls > ctx->lod_threshold);
+    if (!want) {
+        ctx->lod_density_active = false;
+        ctx->lod_rebuild = true; // Alla prossima attivazione i contatori ripartono da zero
+        return;
+    }
+    if (ctx->lod_rebuild) {
+        if (!lod_allocate(ctx)) {
+            ctx->lod_density_active = false;
+            return;
+        }
+        for (int i = 0; i < ctx->num_balls; i++)
+            ctx->balls[i].lod_cell = -1;
+        ctx->lod_rebuild = false;
+        ctx->lod_texture_stale = true;
+    }
+    ctx->lod_density_active = true;
+    ctx->focus_count = 0;
+    int focus_r2 = ctx->focus_radius * ctx->focus_radius;
+    for (int i = 0; i < ctx->num_balls; i++) {
+        Ball* b = &ctx->balls[i];
+        if (!b->active || !b->task_params) continue;
+        int cx = (int)(b->x / LOD_CELL_SIZE);
+        int cy = (int)(b->y / LOD_CELL_SIZE);
+        cx = cx < 0 ? 0 : (cx >= ctx->lod_cols ? ctx->lod_cols - 1 : cx);
+        cy = cy < 0 ? 0 : (cy >= ctx->lod_rows ? ctx->lod_rows - 1 : cy);
+        int cell = cy * ctx->lod_cols + cx;
+        int state = ball_lod_state(b);
+        if (cell != b->lod_cell || state != b->lod_state) {
+            if (b->lod_cell >= 0) {
+                ctx->lod_counts[b->lod_cell * LOD_NUM_STATES + b->lod_state]--;
+                lod_mark_dirty(ctx, b->lod_cell);
+            }
+            ctx->lod_counts[cell * LOD_NUM_STATES + state]++;
+            lod_mark_dirty(ctx, cell);
+            b->lod_cell = cell;
+            b->lod_state = state;
+        }
+        if (ctx->focus_radius > 0 && ctx->focus_count < LOD_FOCUS_MAX) {
+            float dx = b->x - ctx->focus_x, dy = b->y - ctx->focus_y;
+            if (dx * dx + dy * dy <= focus_r2)
+                ctx->focus_balls[ctx->focus_count++] = i;
+        }
+    }
+}
+
+// Imposta la modalità di livello di dettaglio e la soglia per BB_LOD_AUTO
+void bb_set_lod(bb_context *ctx, bouncing_balls_lod_mode mode, int threshold) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    ctx->lod_mode = mode;
+    if (threshold > 0) ctx->lod_threshold = threshold < MAX_BALLS ? threshold : MAX_BALLS;
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Imposta la zona di fuoco in cui le palline sono disegnate singolarmente (radius <= 0 la disattiva)
+void bb_set_focus(bb_context *ctx, int x, int y, int radius) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    ctx->focus_x = x;
+    ctx->focus_y = y;
+    ctx->focus_radius = radius > 0 ? radius : 0;
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Mostra o nasconde la timeline; window_ms > 0 cambia la finestra temporale
+void bb_set_timeline(bb_context *ctx, bool visible, int window_ms) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    ctx->timeline_visible = visible && ctx->task_timeline != NULL;
+    if (ctx->task_timeline && window_ms > 0)
+        timeline_set_window(ctx->task_timeline, window_ms);
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Mostra o nasconde il pannello delle statistiche per task
+void bb_set_stats(bb_context *ctx, bool visible) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    ctx->stats_visible = visible;
+    pthread_mutex_unlock(ctx->lock);
+}
+
+// Attiva o disattiva gli urti tra palline
+void bb_set_collisions(bb_context *ctx, bool enabled) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    ctx->collisions_enabled = enabled;
+    pthread_mutex_unlock(ctx->lock);
 }
 
 // Aggiorna la simulazione delle palline (movimento, rimbalzi, stato)
-void bouncing_balls_update(void) {
-    al_lock_mutex(task_mutex);
-    float ground_level = screen_h * 0.9f;
+void bb_update(bb_context *ctx) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    float ground_level = ctx->screen_h * 0.9f;
     float ground_position = ground_level - BALL_RADIUS;
     float ceiling_position = BALL_RADIUS + 20;
     float available_height = ground_position - ceiling_position;
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
-    for (int i = 0; i < num_balls; i++) {
-        Ball* b = &balls[i];
+    for (int i = 0; i < ctx->num_balls; i++) {
+        Ball* b = &ctx->balls[i];
         if (!b->active || !b->task_params) continue;
         b->x += b->vx;
         if (b->x - b->radius < 0) {
             b->x = b->radius;
             b->vx = 1.0f;
-        } else if (b->x + b->radius > screen_w) {
-            b->x = screen_w - b->radius;
+        } else if (b->x + b->radius > ctx->screen_w) {
+            b->x = ctx->screen_w - b->radius;
             b->vx = -1.0f;
         }
         if (b->task_params->periodo > 0) {
@@ -277,114 +1055,496 @@ void bouncing_balls_update(void) {
             }
         }
     }
-    al_unlock_mutex(task_mutex);
+    if (ctx->collisions_enabled)
+        resolve_ball_collisions(ctx);
+    // Il lampeggio per deadline miss si consuma qui, così vale anche per le palline aggregate
+    if ((al_get_timer_count(ctx->timer) % 30) == 0) {
+        for (int i = 0; i < ctx->num_balls; i++) {
+            if (ctx->balls[i].dead_flashes > 0)
+                ctx->balls[i].dead_flashes--;
+        }
+    }
+    update_lod(ctx);
+    pthread_mutex_unlock(ctx->lock);
 }
 
-// Disegna tutte le palline e le informazioni a schermo
-void bouncing_balls_draw(void) {
-    al_clear_to_color(al_map_rgb(16, 16, 32));
-    al_lock_mutex(task_mutex);
-    // Pannello informativo in alto
-    char info[200];
-    if (currently_executing_task >= 0) {
-        snprintf(info, sizeof(info), "TASK ATTIVI: %d | DEADLINE PERSE: %d | IN ESECUZIONE: TASK %d | ESECUZIONI TOT: %d", 
-                num_balls, total_deadline_misses, currently_executing_task, total_executions);
+// Livello di overlay di un task nella lista dei recenti (-1 = non recente)
+static int recent_overlay_level(bb_context *ctx, int task_id) {
+    for (int j = 0; j < ctx->recent_execution_count; j++) {
+        if (ctx->recent_executions[j] == task_id)
+            return j;
+    }
+    return -1;
+}
+
+// Disegna una singola pallina con bordo, lampeggio e ID
+// Colore che identifica una CPU (anelli delle palline e bordi delle corsie)
+static ALLEGRO_COLOR cpu_color(int cpu) {
+    static const unsigned char palette[8][3] = {
+        {255, 80, 80}, {80, 200, 255}, {255, 200, 60}, {160, 110, 255},
+        {80, 255, 140}, {255, 120, 220}, {255, 150, 60}, {200, 200, 200}
+    };
+    const unsigned char *p = palette[cpu % 8];
+    return al_map_rgb(p[0], p[1], p[2]);
+}
+
+static void draw_ball(bb_context *ctx, Ball *b, int flash_state) {
+    int overlay_level = recent_overlay_level(ctx, b->task_params->id);
+    float scale_factor = 1.0f;
+    float brightness_factor = 1.0f;
+    if (overlay_level >= 0) {
+        scale_factor = 1.3f - (overlay_level * 0.05f);
+        scale_factor = fmaxf(scale_factor, 1.0f);
+        brightness_factor = 1.3f - (overlay_level * 0.05f);
+        brightness_factor = fmaxf(brightness_factor, 1.0f);
+    }
+    if (b->executing) scale_factor *= 1.1f;
+    ALLEGRO_COLOR ball_color = b->color;
+    if (brightness_factor > 1.0f) {
+        ball_color.r = fminf(1.0f, ball_color.r * brightness_factor);
+        ball_color.g = fminf(1.0f, ball_color.g * brightness_factor);
+        ball_color.b = fminf(1.0f, ball_color.b * brightness_factor);
+    }
+    float radius = b->radius * scale_factor;
+    al_draw_filled_circle(b->x, b->y, radius, ball_color);
+    // Bordo rosso lampeggiante per deadline miss
+    if (b->dead_flashes > 0) {
+        if (flash_state == 0)
+            al_draw_circle(b->x, b->y, radius, al_map_rgb(255, 0, 0), 3.0f);
+        else
+            al_draw_circle(b->x, b->y, radius, al_map_rgb(200, 200, 200), 1.0f);
     } else {
-        snprintf(info, sizeof(info), "TASK ATTIVI: %d | DEADLINE PERSE: %d | IN ESECUZIONE: nessuno | ESECUZIONI TOT: %d", 
-                num_balls, total_deadline_misses, total_executions);
-    }
-    al_draw_text(font, al_map_rgb(255, 255, 100), 10, 10, 0, info);
-    draw_priority_groups(font, screen_w); // Mostra gruppi di priorità se necessario
-    float ground_level = screen_h * 0.9f;
-    al_draw_line(0, ground_level, screen_w, ground_level, al_map_rgb(80, 80, 120), 2.0f);
-    int flash_state = (al_get_timer_count(timer) / 30) % 2;
-    int draw_order[MAX_BALLS];
-    int draw_order_count = 0;
-    // Prima disegna i task non recenti, poi quelli recenti (overlay)
-    for (int i = 0; i < num_balls; i++) {
-        Ball* b = &balls[i];
+        float border_width = overlay_level == 0 ? 2.0f : 1.0f;
+        al_draw_circle(b->x, b->y, radius, al_map_rgb(200, 200, 200), border_width);
+    }
+    // Anello esterno del colore della CPU su cui il task sta eseguendo
+    if (b->executing && b->cpu >= 0)
+        al_draw_circle(b->x, b->y, radius + 4, cpu_color(b->cpu), 2.0f);
+    // Disegna l'ID del task sulla pallina
+    char id_str[16];
+    snprintf(id_str, sizeof(id_str), "%d", b->task_params->id);
+    al_draw_text(ctx->font, al_map_rgb(0, 0, 0), b->x, b->y - 5, ALLEGRO_ALIGN_CENTRE, id_str);
+}
+
+// Disegna una corsia per CPU nella fascia sotto il terreno: colore e id del task in
+// esecuzione su ciascuna, così si vedono i core contesi e quelli inattivi
+static void draw_cpu_lanes(bb_context *ctx, float ground_level) {
+    float top = ground_level + 6;
+    float bottom = ctx->screen_h - 4;
+    if (bottom - top < 6) return;
+    float lane_w = (float)ctx->screen_w / ctx->num_cpus;
+    bool labels = lane_w >= 48 && bottom - top >= al_get_font_line_height(ctx->font);
+    for (int c = 0; c < ctx->num_cpus; c++) {
+        float x0 = c * lane_w + 1, x1 = (c + 1) * lane_w - 1;
+        int task_id = ctx->cpu_running[c];
+        ALLEGRO_COLOR fill = task_id >= 0 ? bouncing_balls_get_task_color(task_id) : al_map_rgb(30, 30, 50);
+        al_draw_filled_rectangle(x0, top, x1, bottom, fill);
+        al_draw_rectangle(x0, top, x1, bottom, cpu_color(c), 1.0f);
+        if (labels) {
+            char label[24];
+            if (task_id >= 0) snprintf(label, sizeof(label), "C%d:T%d", c, task_id);
+            else snprintf(label, sizeof(label), "C%d", c);
+            al_draw_text(ctx->font, task_id >= 0 ? al_map_rgb(0, 0, 0) : al_map_rgb(120, 120, 150),
+                         (x0 + x1) / 2, (top + bottom) / 2 - 4, ALLEGRO_ALIGN_CENTRE, label);
+        }
+    }
+}
+
+// Ordine di disegno delle palline in ctx->draw_order: le palline attive in ordine di slot
+// (ricostruito solo dopo aggiunte e rimozioni), poi di nuovo i task recenti, il più recente
+// per ultimo, sopra gli altri: la seconda copia copre del tutto la prima. Ritorna il numero di voci
+static int collect_draw_order(bb_context *ctx) {
+    if (ctx->draw_order_stale) {
+        ctx->draw_base_count = 0;
+        for (int i = 0; i < ctx->num_balls; i++) {
+            if (ctx->balls[i].active && ctx->balls[i].task_params)
+                ctx->draw_order[ctx->draw_base_count++] = i;
+        }
+        ctx->draw_order_stale = false;
+    }
+    int draw_order_count = ctx->draw_base_count;
+    for (int j = ctx->recent_execution_count - 1; j >= 0; j--) {
+        int i = find_ball(ctx, ctx->recent_executions[j]);
+        if (i >= 0) ctx->draw_order[draw_order_count++] = i;
+    }
+    return draw_order_count;
+}
+
+// Gruppi di priorità in cache, ricostruiti solo se l'insieme dei task è cambiato
+static const char *priority_groups(bb_context *ctx) {
+    if (ctx->groups_stale) {
+        build_priority_groups(ctx, ctx->groups_text, sizeof(ctx->groups_text));
+        ctx->groups_stale = false;
+    }
+    return ctx->groups_text;
+}
+
+// Ridisegna nella texture solo le celle modificate dall'ultimo frame
+// Colore per cella: rosso = deadline perse, verde = in esecuzione, blu = inattivi
+static void refresh_density_texture(bb_context *ctx) {
+    if (ctx->lod_bitmap && (al_get_bitmap_width(ctx->lod_bitmap) != ctx->lod_cols || al_get_bitmap_height(ctx->lod_bitmap) != ctx->lod_rows)) {
+        al_destroy_bitmap(ctx->lod_bitmap);
+        ctx->lod_bitmap = NULL;
+    }
+    if (!ctx->lod_bitmap) {
+        int old_format = al_get_new_bitmap_format();
+        al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+        ctx->lod_bitmap = al_create_bitmap(ctx->lod_cols, ctx->lod_rows);
+        al_set_new_bitmap_format(old_format);
+        if (!ctx->lod_bitmap) return;
+        ctx->lod_texture_stale = true;
+    }
+    if (!ctx->lod_texture_stale && ctx->lod_dirty_count == 0) return;
+    int x0 = 0, y0 = 0, x1 = ctx->lod_cols - 1, y1 = ctx->lod_rows - 1;
+    if (!ctx->lod_texture_stale) {
+        // Blocca solo il rettangolo che contiene le celle sporche
+        x0 = ctx->lod_cols; y0 = ctx->lod_rows; x1 = -1; y1 = -1;
+        for (int k = 0; k < ctx->lod_dirty_count; k++) {
+            int cx = ctx->lod_dirty[k] % ctx->lod_cols, cy = ctx->lod_dirty[k] / ctx->lod_cols;
+            if (cx < x0) x0 = cx;
+            if (cx > x1) x1 = cx;
+            if (cy < y0) y0 = cy;
+            if (cy > y1) y1 = cy;
+        }
+    }
+    ALLEGRO_LOCKED_REGION *lr = al_lock_bitmap_region(ctx->lod_bitmap, x0, y0, x1 - x0 + 1, y1 - y0 + 1,
+                                                      ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READWRITE);
+    if (!lr) return;
+    int total = ctx->lod_texture_stale ? ctx->lod_cols * ctx->lod_rows : ctx->lod_dirty_count;
+    for (int k = 0; k < total; k++) {
+        int cell = ctx->lod_texture_stale ? k : ctx->lod_dirty[k];
+        int cx = cell % ctx->lod_cols, cy = cell / ctx->lod_cols;
+        unsigned char *px = (unsigned char *)lr->data + (cy - y0) * lr->pitch + (cx - x0) * 4;
+        unsigned short *c = &ctx->lod_counts[cell * LOD_NUM_STATES];
+        int missed = c[LOD_STATE_MISSED], exec = c[LOD_STATE_EXECUTING], idle = c[LOD_STATE_IDLE];
+        int r = missed * 255 / LOD_SATURATION, g = exec * 255 / LOD_SATURATION, bl = idle * 160 / LOD_SATURATION;
+        int a = missed + exec + idle > 0 ? 255 : 0;
+        px[0] = r > 255 ? 255 : r;
+        px[1] = g > 255 ? 255 : g;
+        px[2] = bl > 160 ? 160 : bl;
+        px[3] = a;
+    }
+    al_unlock_bitmap(ctx->lod_bitmap);
+    for (int k = 0; k < ctx->lod_dirty_count; k++)
+        ctx->lod_dirty_flag[ctx->lod_dirty[k]] = 0;
+    ctx->lod_dirty_count = 0;
+    ctx->lod_texture_stale = false;
+}
+
+// Disegna la mappa di densità e, nella zona di fuoco, le palline singole
+static void draw_density(bb_context *ctx, int flash_state) {
+    refresh_density_texture(ctx);
+    if (ctx->lod_bitmap)
+        al_draw_scaled_bitmap(ctx->lod_bitmap, 0, 0, ctx->lod_cols, ctx->lod_rows,
+                              0, 0, ctx->lod_cols * LOD_CELL_SIZE, ctx->lod_rows * LOD_CELL_SIZE, 0);
+    if (ctx->focus_radius > 0) {
+        al_draw_filled_circle(ctx->focus_x, ctx->focus_y, ctx->focus_radius, al_map_rgb(16, 16, 32));
+        for (int k = 0; k < ctx->focus_count; k++)
+            draw_ball(ctx, &ctx->balls[ctx->focus_balls[k]], flash_state);
+        al_draw_circle(ctx->focus_x, ctx->focus_y, ctx->focus_radius, al_map_rgb(255, 255, 100), 1.0f);
+    }
+}
+
+// Disegna il pannello delle statistiche per task (una riga per task, finché c'è spazio)
+static void draw_stats_panel(bb_context *ctx) {
+    int line_height = al_get_font_line_height(ctx->font) + 2;
+    int top = 10 + line_height + 10;
+    int max_rows = (int)(ctx->screen_h * 0.9f - top - 10) / line_height;
+    int rows = 0;
+    char line[160];
+    // Con i contatori di prestazioni attivi il pannello mostra le loro medie per job
+    bool perf = contatori_abilitati();
+    if (perf)
+        snprintf(line, sizeof(line), "TASK  ESEC   MISS  IPC   CACHE MISS/JOB  CS VOL/INV  MIGR/JOB");
+    else
+        snprintf(line, sizeof(line), "TASK  ESEC   MISS  CPU  MIGR  DURATA MED/MAX(ms)  BLOCCO MAX(ms)  BLOCCO TOT(ms)  RIL  JITTER MED/MAX(us)");
+    int panel_w = al_get_text_width(ctx->font, line) + 12;
+    int x = ctx->screen_w - panel_w - 10;
+    int n = 0;
+    for (int i = 0; i < ctx->num_balls; i++)
+        if (ctx->balls[i].active && ctx->balls[i].task_params) n++;
+    if (n > max_rows - 1) n = max_rows - 1;
+    if (n < 0) return;
+    al_draw_filled_rectangle(x, top - 4, x + panel_w, top + (n + 1) * line_height + 2, al_map_rgba(0, 0, 0, 180));
+    al_draw_text(ctx->font, al_map_rgb(255, 255, 100), x + 6, top, 0, line);
+    for (int i = 0; i < ctx->num_balls && rows < n; i++) {
+        Ball* b = &ctx->balls[i];
         if (!b->active || !b->task_params) continue;
-        bool in_recent_list = false;
-        for (int j = 0; j < recent_execution_count; j++) {
-            if (recent_executions[j] == b->task_params->id) {
-                in_recent_list = true;
-                break;
+        parametri *tp = b->task_params;
+        if (perf) {
+            const contatori_job *c = &tp->perf;
+            double job = c->job > 0 ? (double)c->job : 1.0;
+            char cs[24];
+            snprintf(cs, sizeof(cs), "%.1f/%.1f", c->cs_volontari / job, c->cs_involontari / job);
+            snprintf(line, sizeof(line), "%-5d %-6d %-5d %-5.2f %-15.1f %-11s %.3f",
+                     tp->id, b->execution_count, tp->deadperse,
+                     c->cicli ? (double)c->istruzioni / c->cicli : 0.0, c->cache_miss / job,
+                     cs, c->migrazioni / job);
+        } else {
+            char durata[24];
+            snprintf(durata, sizeof(durata), "%.3f/%.3f",
+                     b->exec_measured ? b->exec_tot_ns / 1e6 / b->exec_measured : 0.0, b->exec_max_ns / 1e6);
+            snprintf(line, sizeof(line), "%-5d %-6d %-5d %-4d %-5d %-19s %-15.3f %-15.1f %-4s %.1f/%.1f",
+                     tp->id, b->execution_count, tp->deadperse, b->cpu, b->migrations, durata,
+                     tp->blocco_max_ns / 1e6, tp->blocco_tot_ns / 1e6,
+                     tp->attesa == RILASCIO_IBRIDO ? "IBR" : "SLP",
+                     tp->rilasci ? tp->jitter_tot_ns / 1e3 / tp->rilasci : 0.0, tp->jitter_max_ns / 1e3);
+        }
+        rows++;
+        al_draw_text(ctx->font, b->color, x + 6, top + rows * line_height, 0, line);
+    }
+}
+
+// Segna come sporche le piastrelle toccate dal rettangolo (x0, y0)-(x1, y1)
+static void mark_dirty(bb_context *ctx, float x0, float y0, float x1, float y1) {
+    if (!ctx->dirty_tiles) return;
+    int c0 = (int)floorf(x0) / DIRTY_TILE_SIZE, c1 = (int)ceilf(x1) / DIRTY_TILE_SIZE;
+    int r0 = (int)floorf(y0) / DIRTY_TILE_SIZE, r1 = (int)ceilf(y1) / DIRTY_TILE_SIZE;
+    if (c0 < 0) c0 = 0;
+    if (r0 < 0) r0 = 0;
+    if (c1 >= ctx->dirty_cols) c1 = ctx->dirty_cols - 1;
+    if (r1 >= ctx->dirty_rows) r1 = ctx->dirty_rows - 1;
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            unsigned char *t = &ctx->dirty_tiles[r * ctx->dirty_cols + c];
+            if (!*t) {
+                *t = 1;
+                ctx->dirty_count++;
             }
         }
-        if (!in_recent_list) draw_order[draw_order_count++] = i;
     }
-    for (int j = recent_execution_count - 1; j >= 0; j--) {
-        int task_id = recent_executions[j];
-        for (int i = 0; i < num_balls; i++) {
-            if (balls[i].active && balls[i].task_params && balls[i].task_params->id == task_id) {
-                draw_order[draw_order_count++] = i;
-                break;
+}
+
+// Metà lato del riquadro che contiene la pallina disegnata (ingrandimento dell'overlay,
+// bordo, anello della CPU)
+static float ball_extent(const Ball *b) {
+    return b->radius * 1.45f + 8.0f;
+}
+
+// Riassunto di ciò che cambia l'aspetto di una pallina oltre alla posizione
+static unsigned int ball_look(bb_context *ctx, const Ball *b, int flash_state) {
+    unsigned int look = (unsigned int)(recent_overlay_level(ctx, b->task_params->id) + 1);
+    if (b->executing) look |= 1u << 5 | (unsigned int)(b->cpu & 0xff) << 6;
+    if (b->dead_flashes > 0) look |= (unsigned int)(1 + flash_state) << 14;
+    return look;
+}
+
+// Adatta back buffer e mappa sporca alle dimensioni della finestra (ridisegno completo)
+static bool ensure_scene(bb_context *ctx) {
+    if (ctx->scene && (al_get_bitmap_width(ctx->scene) != ctx->screen_w || al_get_bitmap_height(ctx->scene) != ctx->screen_h)) {
+        al_destroy_bitmap(ctx->scene);
+        ctx->scene = NULL;
+    }
+    if (!ctx->scene) {
+        ctx->scene = al_create_bitmap(ctx->screen_w, ctx->screen_h);
+        if (!ctx->scene) return false;
+        free(ctx->dirty_tiles);
+        ctx->dirty_cols = (ctx->screen_w + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+        ctx->dirty_rows = (ctx->screen_h + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+        ctx->dirty_tiles = calloc((size_t)ctx->dirty_cols * ctx->dirty_rows, 1);
+        ctx->dirty_count = 0;
+        ctx->scene_invalid = true;
+        if (!ctx->dirty_tiles) {
+            al_destroy_bitmap(ctx->scene);
+            ctx->scene = NULL;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ridisegna la scena dentro il rettangolo (x, y, w, h) del target corrente
+static void repaint_region(bb_context *ctx, int x, int y, int w, int h, const char *info, const char *groups,
+                           const int *draw_order, int draw_order_count, int flash_state, float ground_level) {
+    al_set_clipping_rectangle(x, y, w, h);
+    al_clear_to_color(SCENE_BACKGROUND);
+    if (y < ctx->drawn_groups_bottom)
+        draw_priority_groups(ctx, groups);
+    if (y <= ground_level + 2 && y + h >= ground_level - 2)
+        al_draw_line(0, ground_level, ctx->screen_w, ground_level, al_map_rgb(80, 80, 120), 2.0f);
+    for (int k = 0; k < draw_order_count; k++) {
+        Ball *b = &ctx->balls[draw_order[k]];
+        float e = b->drawn_extent;
+        if (b->drawn_x + e < x || b->drawn_x - e > x + w || b->drawn_y + e < y || b->drawn_y - e > y + h)
+            continue;
+        draw_ball(ctx, b, flash_state);
+    }
+    if (y + h > ground_level + 6)
+        draw_cpu_lanes(ctx, ground_level);
+    if (y < 10 + al_get_font_line_height(ctx->font))
+        al_draw_text(ctx->font, al_map_rgb(255, 255, 100), 10, 10, 0, info);
+}
+
+// Aggiorna il back buffer della scena ridisegnando solo le piastrelle sporche
+static void update_scene(bb_context *ctx, const char *info, int flash_state, float ground_level) {
+    int line_height = al_get_font_line_height(ctx->font);
+    if (ctx->scene_invalid)
+        mark_dirty(ctx, 0, 0, ctx->screen_w, ctx->screen_h);
+    // Testi in alto: si ridisegnano solo se sono cambiati
+    if (strcmp(info, ctx->drawn_info) != 0) {
+        mark_dirty(ctx, 0, 10, ctx->screen_w, 10 + line_height);
+        snprintf(ctx->drawn_info, sizeof(ctx->drawn_info), "%s", info);
+    }
+    const char *groups = priority_groups(ctx);
+    if (ctx->scene_invalid || strcmp(groups, ctx->drawn_groups) != 0) {
+        int top = priority_groups_top(ctx);
+        int bottom = wrap_text(ctx->font, al_map_rgb(0, 0, 0), 10, top, ctx->screen_w - 40, groups, false);
+        mark_dirty(ctx, 0, top, ctx->screen_w, fmaxf(bottom, ctx->drawn_groups_bottom));
+        snprintf(ctx->drawn_groups, sizeof(ctx->drawn_groups), "%s", groups);
+        ctx->drawn_groups_bottom = bottom;
+    }
+    // Corsie CPU cambiate
+    float lane_w = (float)ctx->screen_w / ctx->num_cpus;
+    for (int c = 0; c < ctx->num_cpus; c++) {
+        if (ctx->cpu_running[c] != ctx->drawn_cpu_running[c]) {
+            mark_dirty(ctx, c * lane_w, ground_level + 6, (c + 1) * lane_w, ctx->screen_h);
+            ctx->drawn_cpu_running[c] = ctx->cpu_running[c];
+        }
+    }
+    // Palline spostate o cambiate: riquadro vecchio e nuovo
+    const int *draw_order = ctx->draw_order;
+    int draw_order_count = collect_draw_order(ctx);
+    for (int k = 0; k < draw_order_count; k++) {
+        Ball *b = &ctx->balls[draw_order[k]];
+        float e = ball_extent(b);
+        unsigned int look = ball_look(ctx, b, flash_state);
+        if (b->drawn && b->drawn_x == b->x && b->drawn_y == b->y && b->drawn_extent == e && b->drawn_look == look)
+            continue;
+        if (b->drawn)
+            mark_dirty(ctx, b->drawn_x - b->drawn_extent, b->drawn_y - b->drawn_extent,
+                       b->drawn_x + b->drawn_extent, b->drawn_y + b->drawn_extent);
+        mark_dirty(ctx, b->x - e, b->y - e, b->x + e, b->y + e);
+        b->drawn = true;
+        b->drawn_x = b->x;
+        b->drawn_y = b->y;
+        b->drawn_extent = e;
+        b->drawn_look = look;
+    }
+    ctx->scene_invalid = false;
+    if (ctx->dirty_count == 0) return;
+    al_set_target_bitmap(ctx->scene);
+    if (ctx->dirty_count * 2 > ctx->dirty_cols * ctx->dirty_rows) {
+        // Più di metà schermo: un solo ridisegno completo costa meno di tanti rettangoli
+        repaint_region(ctx, 0, 0, ctx->screen_w, ctx->screen_h, info, groups, draw_order, draw_order_count, flash_state, ground_level);
+        memset(ctx->dirty_tiles, 0, (size_t)ctx->dirty_cols * ctx->dirty_rows);
+        ctx->dirty_count = 0;
+        ctx->present_all = true;
+    } else {
+        // Una striscia per ogni sequenza di piastrelle sporche consecutive in una riga;
+        // le piastrelle restano segnate per present_scene, che copia le stesse strisce
+        for (int r = 0; r < ctx->dirty_rows; r++) {
+            unsigned char *row = &ctx->dirty_tiles[r * ctx->dirty_cols];
+            for (int c = 0; c < ctx->dirty_cols; c++) {
+                if (!row[c]) continue;
+                int c0 = c;
+                while (c < ctx->dirty_cols && row[c]) c++;
+                repaint_region(ctx, c0 * DIRTY_TILE_SIZE, r * DIRTY_TILE_SIZE, (c - c0) * DIRTY_TILE_SIZE, DIRTY_TILE_SIZE,
+                               info, groups, draw_order, draw_order_count, flash_state, ground_level);
             }
         }
     }
-    // Disegna le palline nell'ordine determinato
-    for (int idx = 0; idx < draw_order_count; idx++) {
-        int i = draw_order[idx];
-        Ball* b = &balls[i];
-        int overlay_level = -1;
-        for (int j = 0; j < recent_execution_count; j++) {
-            if (recent_executions[j] == b->task_params->id) {
-                overlay_level = j;
-                break;
+    al_reset_clipping_rectangle();
+}
+
+// Copia la scena sul backbuffer: solo le strisce ridisegnate se il backbuffer conserva il
+// frame precedente e questo coincideva con la scena, altrimenti per intero
+static void present_scene(bb_context *ctx) {
+    al_set_target_backbuffer(ctx->display);
+    if (!ctx->backbuffer_kept || ctx->present_stale || ctx->present_all) {
+        al_draw_bitmap(ctx->scene, 0, 0, 0);
+        memset(ctx->dirty_tiles, 0, (size_t)ctx->dirty_cols * ctx->dirty_rows);
+    } else if (ctx->dirty_count > 0) {
+        for (int r = 0; r < ctx->dirty_rows; r++) {
+            unsigned char *row = &ctx->dirty_tiles[r * ctx->dirty_cols];
+            for (int c = 0; c < ctx->dirty_cols; c++) {
+                if (!row[c]) continue;
+                int c0 = c;
+                while (c < ctx->dirty_cols && row[c]) row[c++] = 0;
+                int x = c0 * DIRTY_TILE_SIZE, y = r * DIRTY_TILE_SIZE;
+                al_draw_bitmap_region(ctx->scene, x, y, (c - c0) * DIRTY_TILE_SIZE, DIRTY_TILE_SIZE, x, y, 0);
             }
         }
-        float scale_factor = 1.0f;
-        float brightness_factor = 1.0f;
-        if (overlay_level >= 0) {
-            scale_factor = 1.3f - (overlay_level * 0.05f);
-            scale_factor = fmaxf(scale_factor, 1.0f);
-            brightness_factor = 1.3f - (overlay_level * 0.05f);
-            brightness_factor = fmaxf(brightness_factor, 1.0f);
-        }
-        if (b->executing) scale_factor *= 1.1f;
-        ALLEGRO_COLOR ball_color = b->color;
-        if (brightness_factor > 1.0f) {
-            ball_color.r = fminf(1.0f, ball_color.r * brightness_factor);
-            ball_color.g = fminf(1.0f, ball_color.g * brightness_factor);
-            ball_color.b = fminf(1.0f, ball_color.b * brightness_factor);
-        }
-        float radius = b->radius * scale_factor;
-        al_draw_filled_circle(b->x, b->y, radius, ball_color);
-        // Bordo rosso lampeggiante per deadline miss
-        if (b->dead_flashes > 0) {
-            if (flash_state == 0)
-                al_draw_circle(b->x, b->y, radius, al_map_rgb(255, 0, 0), 3.0f);
-            else
-                al_draw_circle(b->x, b->y, radius, al_map_rgb(200, 200, 200), 1.0f);
-            if ((al_get_timer_count(timer) % 30) == 0)
-                b->dead_flashes--;
-        } else {
-            float border_width = overlay_level == 0 ? 2.0f : 1.0f;
-            al_draw_circle(b->x, b->y, radius, al_map_rgb(200, 200, 200), border_width);
+    }
+    ctx->dirty_count = 0;
+    ctx->present_all = false;
+    // Timeline e statistiche vengono disegnate sopra: il prossimo frame le deve cancellare
+    ctx->present_stale = ctx->timeline_visible || ctx->stats_visible;
+}
+
+// Disegna tutte le palline e le informazioni a schermo
+void bb_draw(bb_context *ctx) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    // Pannello informativo in alto
+    char info[200];
+    int busy_cpus = 0;
+    for (int c = 0; c < ctx->num_cpus; c++)
+        if (ctx->cpu_running[c] >= 0) busy_cpus++;
+    snprintf(info, sizeof(info), "TASK ATTIVI: %d | DEADLINE PERSE: %d | IN ESECUZIONE: %d/%d CPU | ESECUZIONI TOT: %d", 
+            ctx->active_balls, ctx->total_deadline_misses, busy_cpus, ctx->num_cpus, ctx->total_executions);
+    int flash_state = (al_get_timer_count(ctx->timer) / 30) % 2;
+    float ground_level = ctx->screen_h * 0.9f;
+    al_set_target_backbuffer(ctx->display); // Ogni contesto disegna sulla propria finestra
+    if (ctx->lod_density_active) {
+        // Con la mappa di densità i gruppi di priorità non sono leggibili: si salta l'overlay.
+        // La mappa si copia già con un solo blit: qui si disegna tutto direttamente
+        al_clear_to_color(SCENE_BACKGROUND);
+        draw_density(ctx, flash_state);
+        al_draw_line(0, ground_level, ctx->screen_w, ground_level, al_map_rgb(80, 80, 120), 2.0f);
+        draw_cpu_lanes(ctx, ground_level);
+        al_draw_text(ctx->font, al_map_rgb(255, 255, 100), 10, 10, 0, info);
+        ctx->scene_invalid = true; // Tornando alle palline la scena va ridisegnata per intero
+        ctx->present_stale = true;
+    } else if (ensure_scene(ctx)) {
+        update_scene(ctx, info, flash_state, ground_level);
+        present_scene(ctx);
+    } else {
+        // Senza back buffer si ridisegna l'intera scena ad ogni frame
+        const char *groups = priority_groups(ctx);
+        ctx->drawn_groups_bottom = ctx->screen_h;
+        int draw_order_count = collect_draw_order(ctx);
+        for (int k = 0; k < draw_order_count; k++) {
+            Ball *b = &ctx->balls[ctx->draw_order[k]];
+            b->drawn_x = b->x;
+            b->drawn_y = b->y;
+            b->drawn_extent = ball_extent(b);
         }
-        // Disegna l'ID del task sulla pallina
-        char id_str[16];
-        snprintf(id_str, sizeof(id_str), "%d", b->task_params->id);
-        al_draw_text(font, al_map_rgb(0, 0, 0), b->x, b->y - 5, ALLEGRO_ALIGN_CENTRE, id_str);
+        repaint_region(ctx, 0, 0, ctx->screen_w, ctx->screen_h, info, groups, ctx->draw_order, draw_order_count, flash_state, ground_level);
+        al_reset_clipping_rectangle();
+        ctx->scene_invalid = true;
+        ctx->present_stale = true;
+    }
+    if (ctx->timeline_visible) {
+        // La timeline occupa la fascia tra metà schermo e il terreno
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int top = ctx->screen_h / 2;
+        timeline_draw(ctx->task_timeline, ctx->font, 0, top, ctx->screen_w, (int)ground_level - 2 - top, &now);
     }
-    al_unlock_mutex(task_mutex);
+    if (ctx->stats_visible)
+        draw_stats_panel(ctx);
+    pthread_mutex_unlock(ctx->lock);
     al_flip_display();
 }
 
 // Gestisce il ridimensionamento della finestra e delle palline
-void bouncing_balls_resize(int new_w, int new_h) {
-    al_lock_mutex(task_mutex);
-    float scale_x = (float)new_w / screen_w;
-    float scale_y = (float)new_h / screen_h;
-    for (int i = 0; i < num_balls; i++) {
-        balls[i].x *= scale_x;
-        balls[i].y *= scale_y;
-        balls[i].x = fminf(fmaxf(balls[i].x, balls[i].radius), new_w - balls[i].radius);
-        balls[i].y = fminf(fmaxf(balls[i].y, balls[i].radius), new_h - balls[i].radius);
+void bb_resize(bb_context *ctx, int new_w, int new_h) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    float scale_x = (float)new_w / ctx->screen_w;
+    float scale_y = (float)new_h / ctx->screen_h;
+    for (int i = 0; i < ctx->num_balls; i++) {
+        ctx->balls[i].x *= scale_x;
+        ctx->balls[i].y *= scale_y;
+        ctx->balls[i].x = fminf(fmaxf(ctx->balls[i].x, ctx->balls[i].radius), new_w - ctx->balls[i].radius);
+        ctx->balls[i].y = fminf(fmaxf(ctx->balls[i].y, ctx->balls[i].radius), new_h - ctx->balls[i].radius);
     }
-    screen_w = new_w;
-    screen_h = new_h;
-    al_unlock_mutex(task_mutex);
+    ctx->screen_w = new_w;
+    ctx->screen_h = new_h;
+    ctx->lod_rebuild = true; // La mappa di densità va ridimensionata
+    pthread_mutex_unlock(ctx->lock);
 }
 
 // Calcola la differenza in millisecondi tra due struct timespec
@@ -392,26 +1552,23 @@ long bouncing_balls_diff_timespec_ms(struct timespec *a, struct timespec *b) {
     return (a->tv_sec - b->tv_sec) * 1000 + (a->tv_nsec - b->tv_nsec) / 1000000;
 }
 
-// Variabile per la politica di scheduling corrente
-static schedulazione current_scheduler = OTHER;
-
-// Disegna i gruppi di task con la stessa priorità (solo se non SCHED_OTHER e DEADLINE)
-void draw_priority_groups(ALLEGRO_FONT *font, int window_w) {
-    if (current_scheduler == OTHER || current_scheduler == DEADLINE) return;
-    char buf[1024] = "";
+// Testo dei gruppi di task con la stessa priorità (solo FIFO/RR). Ritorna false se non ce ne sono
+static bool build_priority_groups(bb_context *ctx, char *buf, size_t size) {
+    buf[0] = '\0';
+    if (ctx->current_scheduler == OTHER || ctx->current_scheduler == DEADLINE) return false;
     bool found = false;
     bool processed[MAX_BALLS] = {false};
-    for (int i = 0; i < num_balls; i++) {
-        if (!balls[i].active || !balls[i].task_params || processed[i]) continue;
+    for (int i = 0; i < ctx->num_balls; i++) {
+        if (!ctx->balls[i].active || !ctx->balls[i].task_params || processed[i]) continue;
         int group_size = 1;
-        int group_priority = balls[i].task_params->priorita;
+        int group_priority = ctx->balls[i].task_params->priorita;
         char group[256] = "";
-        snprintf(group, sizeof(group), "P:%d [%d", group_priority, balls[i].task_params->id);
+        snprintf(group, sizeof(group), "P:%d [%d", group_priority, ctx->balls[i].task_params->id);
         processed[i] = true;
-        for (int j = i + 1; j < num_balls; j++) {
-            if (balls[j].active && balls[j].task_params && !processed[j] && balls[j].task_params->priorita == group_priority) {
+        for (int j = i + 1; j < ctx->num_balls; j++) {
+            if (ctx->balls[j].active && ctx->balls[j].task_params && !processed[j] && ctx->balls[j].task_params->priorita == group_priority) {
                 char tmp[16];
-                snprintf(tmp, sizeof(tmp), ",%d", balls[j].task_params->id);
+                snprintf(tmp, sizeof(tmp), ",%d", ctx->balls[j].task_params->id);
                 strncat(group, tmp, sizeof(group) - strlen(group) - 1);
                 processed[j] = true;
                 group_size++;
@@ -419,26 +1576,33 @@ void draw_priority_groups(ALLEGRO_FONT *font, int window_w) {
         }
         if (group_size > 1) {
             strncat(group, "] ", sizeof(group) - strlen(group) - 1);
-            strncat(buf, group, sizeof(buf) - strlen(buf) - 1);
+            strncat(buf, group, size - strlen(buf) - 1);
             found = true;
         }
     }
-    if (found) {
-        int line_height = al_get_font_line_height(font);
-        int start_y = 10 + line_height + 10;
-        int effective_width = al_get_display_width(al_get_current_display());
-        int max_text_width = effective_width - 40;
-        bouncing_balls_draw_wrapped_text(font, al_map_rgb(255, 255, 0), 10, start_y, max_text_width, buf);
-    }
+    return found;
 }
 
-// Funzione per disegnare testo con wrapping automatico
-void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, int x, int y, int max_width, const char *text) {
-    if (!font || !text) return;
+// Inizio verticale del testo dei gruppi di priorità (sotto la riga informativa)
+static int priority_groups_top(bb_context *ctx) {
+    return 10 + al_get_font_line_height(ctx->font) + 10;
+}
+
+// Disegna i gruppi di priorità (testo già costruito con build_priority_groups)
+static void draw_priority_groups(bb_context *ctx, const char *groups) {
+    if (groups[0])
+        wrap_text(ctx->font, al_map_rgb(255, 255, 0), 10, priority_groups_top(ctx), ctx->screen_w - 40, groups, true);
+}
+
+// Testo con wrapping automatico; con draw = false misura soltanto.
+// Ritorna la coordinata y sotto l'ultima riga (y se non c'è testo)
+static int wrap_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, int x, int y, int max_width, const char *text, bool draw) {
+    if (!font || !text) return y;
     int line_height = al_get_font_line_height(font);
     int current_y = y;
     int current_x = x;
     int line_spacing = line_height + 5;
+    int bottom = y;
     char line_buffer[512] = "";
     int line_len = 0;
     char text_copy[1024];
@@ -455,7 +1619,8 @@ void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, i
             if (needed_len < (int)sizeof(test_line)) {
                 snprintf(test_line, sizeof(test_line), "%s %s", line_buffer, word);
             } else {
-                al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+                if (draw) al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+                bottom = current_y + line_height;
                 current_y += line_spacing;
                 snprintf(test_line, sizeof(test_line), "%s", word);
                 strcpy(line_buffer, "");
@@ -464,7 +1629,8 @@ void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, i
         }
         int text_width = al_get_text_width(font, test_line);
         if (text_width > max_width && line_len > 0) {
-            al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+            if (draw) al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+            bottom = current_y + line_height;
             current_y += line_spacing;
             int display_height = al_get_display_height(al_get_current_display());
             if (current_y + line_height > display_height - 50) break;
@@ -481,16 +1647,23 @@ void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, i
     if (line_len > 0) {
         int display_height = al_get_display_height(al_get_current_display());
         if (current_y + line_height <= display_height - 50) {
-            al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+            if (draw) al_draw_text(font, color, current_x, current_y, 0, line_buffer);
+            bottom = current_y + line_height;
         }
     }
+    return bottom;
+}
+
+// Funzione per disegnare testo con wrapping automatico
+void bouncing_balls_draw_wrapped_text(ALLEGRO_FONT *font, ALLEGRO_COLOR color, int x, int y, int max_width, const char *text) {
+    wrap_text(font, color, x, y, max_width, text, true);
 }
 
 // Imposta il titolo della finestra
-void bouncing_balls_set_title(const char *title) {
-    ALLEGRO_DISPLAY *display = bouncing_balls_get_display();
-    if (display && title) {
-        al_set_window_title(display, title);
+void bb_set_title(bb_context *ctx, const char *title) {
+    ctx = resolve(ctx);
+    if (ctx && ctx->display && title) {
+        al_set_window_title(ctx->display, title);
     }
 }
 
@@ -505,7 +1678,52 @@ const char* bouncing_balls_get_version(void) {
 }
 
 // Imposta la politica di scheduling corrente (per la visualizzazione)
-void bouncing_balls_set_scheduler(schedulazione sched) {
-    current_scheduler = sched;
+void bb_set_scheduler(bb_context *ctx, schedulazione sched) {
+    ctx = resolve(ctx);
+    if (!ctx) return;
+    pthread_mutex_lock(ctx->lock);
+    if (ctx->current_scheduler != sched) ctx->groups_stale = true;
+    ctx->current_scheduler = sched;
+    pthread_mutex_unlock(ctx->lock);
 }
 
+// *** API CON CONTESTO PREDEFINITO ***
+// Le funzioni bouncing_balls_* sono involucri sottili sul contesto predefinito
+
+// Inizializza la libreria grafica creando il contesto predefinito
+// (il suo mutex è quello predefinito di time0, condiviso con i task non visualizzati)
+bool bouncing_balls_init(int w, int h) {
+    if (default_ctx) return true;
+    default_ctx = create_context(w, h, time0_mutex());
+    return default_ctx != NULL;
+}
+
+// Libera tutte le risorse del contesto predefinito
+void bouncing_balls_shutdown(void) {
+    bb_context_destroy(default_ctx);
+}
+
+// Restituisce il contesto predefinito (NULL prima di bouncing_balls_init)
+bb_context *bouncing_balls_default_context(void) { return default_ctx; }
+
+ALLEGRO_DISPLAY* bouncing_balls_get_display(void) { return bb_get_display(NULL); }
+ALLEGRO_EVENT_QUEUE* bouncing_balls_get_event_queue(void) { return bb_get_event_queue(NULL); }
+ALLEGRO_TIMER* bouncing_balls_get_timer(void) { return bb_get_timer(NULL); }
+bb_handle bouncing_balls_add_task(parametri *params) { return bb_add_task(NULL, params); }
+void bouncing_balls_remove_task(bb_handle h) { bb_remove_task(NULL, h); }
+void bouncing_balls_update(void) { bb_update(NULL); }
+void bouncing_balls_draw(void) { bb_draw(NULL); }
+void bouncing_balls_notify_deadline_miss(int task_id) { bb_notify_deadline_miss(NULL, task_id); }
+void bouncing_balls_notify_execution_start(int task_id) { bb_notify_execution_start(NULL, task_id); }
+void bouncing_balls_notify_execution_end(int task_id) { bb_notify_execution_end(NULL, task_id); }
+void bouncing_balls_notify_execution_start_at(int task_id, int cpu, const struct timespec *ts, unsigned long long job) { bb_notify_execution_start_at(NULL, task_id, cpu, ts, job); }
+void bouncing_balls_notify_execution_end_at(int task_id, int cpu, const struct timespec *ts, unsigned long long job) { bb_notify_execution_end_at(NULL, task_id, cpu, ts, job); }
+int bouncing_balls_notify_batch(const bb_event *ev, int n) { return bb_notify_batch(NULL, ev, n); }
+void bouncing_balls_set_scheduler(schedulazione sched) { bb_set_scheduler(NULL, sched); }
+void bouncing_balls_set_collisions(bool enabled) { bb_set_collisions(NULL, enabled); }
+void bouncing_balls_set_lod(bouncing_balls_lod_mode mode, int threshold) { bb_set_lod(NULL, mode, threshold); }
+void bouncing_balls_set_focus(int x, int y, int radius) { bb_set_focus(NULL, x, y, radius); }
+void bouncing_balls_set_timeline(bool visible, int window_ms) { bb_set_timeline(NULL, visible, window_ms); }
+void bouncing_balls_set_stats(bool visible) { bb_set_stats(NULL, visible); }
+void bouncing_balls_resize(int new_w, int new_h) { bb_resize(NULL, new_w, new_h); }
+void bouncing_balls_set_title(const char *title) { bb_set_title(NULL, title); }
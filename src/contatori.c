@@ -0,0 +1,199 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "contatori.h"
+#include "strumenti.h"
+
+// Contatori del gruppo, nell'ordine in cui si provano ad aprire
+enum { C_CICLI, C_ISTRUZIONI, C_CACHE_MISS, C_MIGRAZIONI, C_PAGE_FAULT, C_NUM };
+
+static const struct {
+    unsigned int tipo;
+    unsigned long long config;
+} contatori_def[C_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+// Stato per thread: il gruppo è legato al thread che lo apre
+typedef struct {
+    int stato;                     // 0 = da aprire, 1 = aperto (anche solo in parte)
+    int fd[C_NUM];                 // -1 = contatore non disponibile
+    int posizione[C_NUM];          // Indice del valore nella lettura di gruppo
+    int num;                       // Contatori aperti nel gruppo
+    unsigned long long inizio[C_NUM];
+    long cs_vol, cs_invol;         // Da getrusage all'inizio del job
+    int in_job;
+} contatori_thread;
+
+static volatile int contatori_attivi = 0;
+static _Thread_local contatori_thread ct;
+static pthread_key_t chiave_chiusura;
+static pthread_once_t chiave_once = PTHREAD_ONCE_INIT;
+
+// Chiude i descrittori del thread quando termina
+static void chiude_gruppo(void *arg)
+{
+    contatori_thread *c = arg;
+    for (int i = 0; i < C_NUM; i++)
+        if (c->fd[i] >= 0)
+            close(c->fd[i]);
+}
+
+static void crea_chiave(void)
+{
+    pthread_key_create(&chiave_chiusura, chiude_gruppo);
+}
+
+static int apre_contatore(int i, int leader, int escludi_kernel)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = contatori_def[i].tipo;
+    attr.config = contatori_def[i].config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = escludi_kernel;
+    attr.exclude_hv = 1;
+    attr.disabled = leader < 0; // Il gruppo parte quando il leader viene abilitato
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+// Apre il gruppo sul thread corrente; i contatori rifiutati vengono saltati
+static void apre_gruppo(void)
+{
+    int leader = -1;
+    ct.num = 0;
+    for (int i = 0; i < C_NUM; i++)
+    {
+        // I contatori hardware contano solo lo spazio utente (basta con perf_event_paranoid 2);
+        // quelli software nascono nel kernel e vanno provati prima senza esclusione
+        int fd = contatori_def[i].tipo == PERF_TYPE_HARDWARE ? apre_contatore(i, leader, 1) : apre_contatore(i, leader, 0);
+        if (fd < 0 && contatori_def[i].tipo == PERF_TYPE_SOFTWARE)
+            fd = apre_contatore(i, leader, 1);
+        ct.fd[i] = fd;
+        ct.posizione[i] = fd >= 0 ? ct.num++ : -1;
+        if (fd >= 0 && leader < 0)
+            leader = fd;
+    }
+    if (leader >= 0)
+    {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        pthread_once(&chiave_once, crea_chiave);
+        pthread_setspecific(chiave_chiusura, &ct);
+    }
+    ct.stato = 1;
+}
+
+// Legge tutti i contatori del gruppo con una sola read()
+static void legge(unsigned long long valori[C_NUM], long *cs_vol, long *cs_invol)
+{
+    unsigned long long buf[1 + C_NUM];
+    memset(valori, 0, C_NUM * sizeof(unsigned long long));
+    int leader = -1;
+    for (int i = 0; i < C_NUM && leader < 0; i++)
+        leader = ct.fd[i];
+    if (leader >= 0 && read(leader, buf, sizeof(buf)) > 0)
+    {
+        for (int i = 0; i < C_NUM; i++)
+            if (ct.posizione[i] >= 0 && (unsigned long long)ct.posizione[i] < buf[0])
+                valori[i] = buf[1 + ct.posizione[i]];
+    }
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+    {
+        *cs_vol = ru.ru_nvcsw;
+        *cs_invol = ru.ru_nivcsw;
+    }
+    else
+        *cs_vol = *cs_invol = 0;
+}
+
+// Abilita/disabilita la misura (senza BB_STRUMENTI time0 non chiama gli agganci: resta spenta)
+void contatori_abilita(int attivi)
+{
+    contatori_attivi = STRUMENTI_ATTIVI && attivi != 0;
+}
+
+int contatori_abilitati(void)
+{
+    return contatori_attivi;
+}
+
+// Inizio di un job: istantanea dei contatori
+void contatori_inizio_job(parametri *tp)
+{
+    (void)tp;
+    if (!contatori_attivi)
+        return;
+    if (ct.stato == 0)
+        apre_gruppo();
+    legge(ct.inizio, &ct.cs_vol, &ct.cs_invol);
+    ct.in_job = 1;
+}
+
+// Fine di un job: differenze sommate nei parametri del task
+void contatori_fine_job(parametri *tp)
+{
+    if (!ct.in_job)
+        return;
+    ct.in_job = 0;
+    unsigned long long fine[C_NUM];
+    long cs_vol, cs_invol;
+    legge(fine, &cs_vol, &cs_invol);
+    long long d[C_NUM];
+    for (int i = 0; i < C_NUM; i++)
+        d[i] = (long long)(fine[i] - ct.inizio[i]);
+
+    pthread_mutex_lock(mutex_task(tp));
+    contatori_job *p = &tp->perf;
+    p->job++;
+    p->cicli += d[C_CICLI];
+    p->istruzioni += d[C_ISTRUZIONI];
+    p->cache_miss += d[C_CACHE_MISS];
+    p->migrazioni += d[C_MIGRAZIONI];
+    p->page_fault += d[C_PAGE_FAULT];
+    p->cs_volontari += cs_vol - ct.cs_vol;
+    p->cs_involontari += cs_invol - ct.cs_invol;
+    if (d[C_CICLI] > p->cicli_max)
+        p->cicli_max = d[C_CICLI];
+    pthread_mutex_unlock(mutex_task(tp));
+}
+
+// Stampa il riepilogo per task
+void contatori_stampa_riepilogo(parametri *tasks, int n)
+{
+    int intestazione = 0;
+    for (int i = 0; i < n; i++)
+    {
+        pthread_mutex_lock(mutex_task(&tasks[i]));
+        contatori_job p = tasks[i].perf;
+        int id = tasks[i].id;
+        pthread_mutex_unlock(mutex_task(&tasks[i]));
+        if (p.job == 0)
+            continue;
+        if (!intestazione)
+        {
+            printf("==== Contatori per job (medie) ====\n");
+            printf("TASK  JOB      CICLI        IPC    CACHE MISS  CS VOL  CS INV  MIGR   PAGE FAULT\n");
+            intestazione = 1;
+        }
+        printf("%-5d %-8lld %-12.0f %-6.2f %-11.1f %-7.2f %-7.2f %-6.3f %.2f\n",
+               id, p.job, (double)p.cicli / p.job,
+               p.cicli ? (double)p.istruzioni / p.cicli : 0.0,
+               (double)p.cache_miss / p.job, (double)p.cs_volontari / p.job,
+               (double)p.cs_involontari / p.job, (double)p.migrazioni / p.job,
+               (double)p.page_fault / p.job);
+    }
+}
@@ -0,0 +1,494 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "esecutore.h"
+
+typedef struct worker worker;
+
+// Task eseguito come coroutine
+typedef struct coroutine {
+    ucontext_t contesto;
+    char *stack;               // Inizio della mappatura (la pagina di guardia è in fondo)
+    parametri *tp;
+    corpo_task corpo;
+    worker *w;                 // Worker che la esegue (non cambia)
+    struct timespec rilascio;  // Prossimo rilascio
+    int in_ritardo;            // Rilascio già passato alla fine del job: ritardo non misurato
+    int avviata;               // Il corpo è partito
+    int termina;               // Esito per esecutore_attende_periodo
+    int finita;                // Il corpo è ritornato
+    double utilizzo;           // wcet / periodo all'avvio (bilanciamento tra worker)
+    struct coroutine *succ;    // Lista dei task dell'esecutore
+} coroutine;
+
+// Thread che esegue le coroutine di una CPU
+struct worker {
+    esecutore *e;
+    pthread_t thread;
+    int cpu;
+    pthread_mutex_t mutex;     // Protegge heap e ferma
+    pthread_cond_t cond;       // Nuovo task o arresto (su CLOCK_MONOTONIC)
+    coroutine **heap;          // Min-heap sui rilasci
+    int dim, cap;
+    int ferma;
+    double utilizzo;           // Somma degli utilizzi dei task assegnati (sotto e->mutex)
+    ucontext_t principale;     // Contesto del ciclo del worker
+    long long cambi;           // Cambi di contesto verso le coroutine (atomico)
+};
+
+struct esecutore {
+    worker *w;
+    int num_worker;
+    size_t dim_stack, pagina;
+    pthread_mutex_t mutex;     // Lista dei task, pool di stack, utilizzi
+    pthread_cond_t fine_cond;  // Fine di una coroutine
+    coroutine *tasks;
+    char **pool;               // Stack liberi da riusare
+    int pool_dim, pool_cap;
+};
+
+static _Thread_local coroutine *corrente = NULL; // Coroutine in esecuzione sul thread
+
+static long long differenza_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+// *** STACK (da chiamare con e->mutex acquisito) ***
+
+// Stack dal pool o nuovo: la pagina più bassa è PROT_NONE, così un overflow
+// termina il processo con SIGSEGV invece di corrompere la memoria vicina
+static char *prende_stack(esecutore *e)
+{
+    if (e->pool_dim > 0)
+        return e->pool[--e->pool_dim];
+    size_t dim = e->dim_stack + e->pagina;
+    char *s = mmap(NULL, dim, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (s == MAP_FAILED)
+        return NULL;
+    if (mprotect(s, e->pagina, PROT_NONE) != 0)
+    {
+        munmap(s, dim);
+        return NULL;
+    }
+    return s;
+}
+
+static void rilascia_stack(esecutore *e, char *s)
+{
+    if (e->pool_dim == e->pool_cap)
+    {
+        int cap = e->pool_cap ? 2 * e->pool_cap : 16;
+        char **p = realloc(e->pool, cap * sizeof(char *));
+        if (!p)
+        {
+            munmap(s, e->dim_stack + e->pagina);
+            return;
+        }
+        e->pool = p;
+        e->pool_cap = cap;
+    }
+    e->pool[e->pool_dim++] = s;
+}
+
+// *** HEAP DEI RILASCI (da chiamare con w->mutex acquisito) ***
+
+static int inserisce(worker *w, coroutine *co)
+{
+    if (w->dim == w->cap)
+    {
+        int cap = w->cap ? 2 * w->cap : 16;
+        coroutine **h = realloc(w->heap, cap * sizeof(coroutine *));
+        if (!h)
+            return -1;
+        w->heap = h;
+        w->cap = cap;
+    }
+    int i = w->dim++;
+    while (i > 0)
+    {
+        int padre = (i - 1) / 2;
+        if (confronta_istanti(w->heap[padre]->rilascio, co->rilascio) <= 0)
+            break;
+        w->heap[i] = w->heap[padre];
+        i = padre;
+    }
+    w->heap[i] = co;
+    return 0;
+}
+
+static coroutine *estrae(worker *w)
+{
+    coroutine *prima = w->heap[0];
+    coroutine *ultima = w->heap[--w->dim];
+    int i = 0;
+    for (;;)
+    {
+        int figlio = 2 * i + 1;
+        if (figlio >= w->dim)
+            break;
+        if (figlio + 1 < w->dim && confronta_istanti(w->heap[figlio + 1]->rilascio, w->heap[figlio]->rilascio) < 0)
+            figlio++;
+        if (confronta_istanti(ultima->rilascio, w->heap[figlio]->rilascio) <= 0)
+            break;
+        w->heap[i] = w->heap[figlio];
+        i = figlio;
+    }
+    if (w->dim > 0)
+        w->heap[i] = ultima;
+    return prima;
+}
+
+// *** COROUTINE ***
+
+// Punto di ingresso delle coroutine: al ritorno del corpo uc_link riporta al worker
+static void trampolino(void)
+{
+    coroutine *co = corrente;
+    co->corpo(co->tp);
+    co->finita = 1;
+}
+
+// Toglie la coroutine finita dall'esecutore e ne ricicla lo stack
+static void conclude(esecutore *e, coroutine *co)
+{
+    pthread_mutex_lock(&e->mutex);
+    for (coroutine **p = &e->tasks; *p; p = &(*p)->succ)
+    {
+        if (*p == co)
+        {
+            *p = co->succ;
+            break;
+        }
+    }
+    co->w->utilizzo -= co->utilizzo;
+    rilascia_stack(e, co->stack);
+    pthread_cond_broadcast(&e->fine_cond);
+    pthread_mutex_unlock(&e->mutex);
+    free(co);
+}
+
+// Rilascio di un job: confine del periodo e ripresa della coroutine fino al prossimo
+static void esegue(worker *w, coroutine *co, struct timespec adesso)
+{
+    parametri *tp = co->tp;
+    pthread_mutex_lock(mutex_task(tp));
+    int termina = tp->termina;
+    pthread_mutex_unlock(mutex_task(tp));
+    if (termina && !co->avviata)
+    {
+        co->finita = 1; // Terminato prima del primo job: il corpo non parte
+        return;
+    }
+    co->termina = termina;
+    if (!termina)
+        time0_rilascio_job(tp, co->rilascio, co->in_ritardo ? -1 : differenza_ns(&adesso, &co->rilascio));
+    co->avviata = 1;
+    corrente = co;
+    swapcontext(&w->principale, &co->contesto);
+    corrente = NULL;
+    __atomic_add_fetch(&w->cambi, 1, __ATOMIC_RELAXED);
+}
+
+static void *worker_thread(void *arg)
+{
+    worker *w = (worker *)arg;
+    pthread_mutex_lock(&w->mutex);
+    for (;;)
+    {
+        if (w->dim == 0)
+        {
+            if (w->ferma)
+                break;
+            pthread_cond_wait(&w->cond, &w->mutex);
+            continue;
+        }
+        struct timespec adesso;
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+        if (confronta_istanti(adesso, w->heap[0]->rilascio) < 0)
+        {
+            // Dorme fino al rilascio più vicino (o a un nuovo task)
+            struct timespec sveglia = w->heap[0]->rilascio;
+            pthread_cond_timedwait(&w->cond, &w->mutex, &sveglia);
+            continue;
+        }
+        coroutine *co = estrae(w);
+        pthread_mutex_unlock(&w->mutex);
+
+        esegue(w, co, adesso);
+
+        pthread_mutex_lock(&w->mutex);
+        if (co->finita || inserisce(w, co) != 0)
+        {
+            pthread_mutex_unlock(&w->mutex);
+            conclude(w->e, co);
+            pthread_mutex_lock(&w->mutex);
+        }
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+// CPU su cui il processo può girare (maschera di sched_getaffinity, non necessariamente
+// 0..n-1: cpuset, CPU isolate o spente). Ritorna il numero di CPU scritte in cpu
+static int cpu_ammesse(int *cpu, int max)
+{
+    cpu_set_t maschera;
+    int n = 0;
+    if (sched_getaffinity(0, sizeof(maschera), &maschera) == 0)
+    {
+        for (int c = 0; c < CPU_SETSIZE && n < max; c++)
+            if (CPU_ISSET(c, &maschera))
+                cpu[n++] = c;
+    }
+    if (n == 0)
+    {
+        // Maschera non leggibile: le CPU online, numerate da 0
+        int online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        for (int c = 0; c < online && n < max; c++)
+            cpu[n++] = c;
+    }
+    if (n == 0)
+        cpu[n++] = 0;
+    return n;
+}
+
+// Crea l'esecutore e i suoi worker
+esecutore *esecutore_crea(int num_worker, schedulazione sched, int priorita, size_t dim_stack)
+{
+    int cpu[CPU_SETSIZE];
+    int num_cpu = cpu_ammesse(cpu, CPU_SETSIZE);
+    if (num_worker <= 0)
+        num_worker = num_cpu;
+    esecutore *e = calloc(1, sizeof(esecutore));
+    if (!e)
+        return NULL;
+    e->w = calloc(num_worker, sizeof(worker));
+    if (!e->w)
+    {
+        free(e);
+        return NULL;
+    }
+    e->pagina = (size_t)sysconf(_SC_PAGESIZE);
+    if (dim_stack == 0)
+        dim_stack = ESECUTORE_STACK_DEFAULT;
+    e->dim_stack = (dim_stack + e->pagina - 1) / e->pagina * e->pagina;
+    // Priority inheritance: worker FIFO/RR e chiamanti (esecutore_rimuove_task) si contendono i mutex
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&e->mutex, &mattr);
+    pthread_cond_init(&e->fine_cond, NULL);
+
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    int policy = sched == FIFO ? SCHED_FIFO : sched == RR ? SCHED_RR : SCHED_OTHER;
+    for (int k = 0; k < num_worker; k++)
+    {
+        worker *w = &e->w[k];
+        w->e = e;
+        w->cpu = cpu[k % num_cpu];
+        pthread_mutex_init(&w->mutex, &mattr);
+        pthread_cond_init(&w->cond, &cattr);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(w->cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+        if (policy != SCHED_OTHER)
+        {
+            struct sched_param param = {.sched_priority = priorita};
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, policy);
+            pthread_attr_setschedparam(&attr, &param);
+        }
+        int ret = pthread_create(&w->thread, &attr, worker_thread, w);
+        if (ret == EPERM)
+        {
+            fprintf(stderr, "esecutore: politica real-time non permessa, worker %d con la politica di default\n", k);
+            pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+            ret = pthread_create(&w->thread, &attr, worker_thread, w);
+        }
+        pthread_attr_destroy(&attr);
+        if (ret)
+        {
+            errno = ret;
+            perror("esecutore_crea");
+            e->num_worker = k;
+            esecutore_distrugge(e);
+            pthread_condattr_destroy(&cattr);
+            pthread_mutexattr_destroy(&mattr);
+            return NULL;
+        }
+        e->num_worker = k + 1;
+    }
+    pthread_condattr_destroy(&cattr);
+    pthread_mutexattr_destroy(&mattr);
+    return e;
+}
+
+// Avvia un task come coroutine sul worker meno carico tra quelli ammessi
+int esecutore_avvia_task(esecutore *e, corpo_task corpo, parametri *tp)
+{
+    coroutine *co = calloc(1, sizeof(coroutine));
+    if (!co)
+        return -1;
+    co->tp = tp;
+    co->corpo = corpo;
+    co->utilizzo = tp->periodo > 0 ? (double)tp->wcet / tp->periodo : 0.0;
+
+    pthread_mutex_lock(&e->mutex);
+    worker *w = NULL;
+    for (int pass = 0; pass < 2 && !w; pass++)
+    {
+        // Primo giro: solo le CPU della maschera; se nessun worker le copre, tutti
+        for (int k = 0; k < e->num_worker; k++)
+        {
+            worker *c = &e->w[k];
+            if (pass == 0 && tp->affinita && (c->cpu >= 64 || !(tp->affinita & (1ULL << c->cpu))))
+                continue;
+            if (!w || c->utilizzo < w->utilizzo)
+                w = c;
+        }
+    }
+    co->stack = prende_stack(e);
+    if (!co->stack)
+    {
+        pthread_mutex_unlock(&e->mutex);
+        free(co);
+        return -1;
+    }
+    co->w = w;
+    w->utilizzo += co->utilizzo;
+    co->succ = e->tasks;
+    e->tasks = co;
+    pthread_mutex_unlock(&e->mutex);
+
+    getcontext(&co->contesto);
+    co->contesto.uc_stack.ss_sp = co->stack + e->pagina;
+    co->contesto.uc_stack.ss_size = e->dim_stack;
+    co->contesto.uc_link = &w->principale;
+    makecontext(&co->contesto, trampolino, 0);
+
+    // Primo rilascio come in set_period: partenza sincrona o subito
+    if (tp->rilascio.tv_sec != 0)
+    {
+        co->rilascio = tp->rilascio;
+        aggiunge_millisecondi(&co->rilascio, tp->offset);
+    }
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC, &co->rilascio);
+        co->in_ritardo = 1;
+    }
+    // Il worker è condiviso con gli altri task della CPU: il task non ha un thread proprio
+    // e le mitigazioni che agiscono sul thread (watchdog_degrada_priorita) lo saltano
+    memset(&tp->thread, 0, sizeof(tp->thread));
+    tp->thread_condiviso = 1;
+
+    pthread_mutex_lock(&w->mutex);
+    int ret = inserisce(w, co);
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    if (ret != 0)
+    {
+        conclude(e, co);
+        return -1;
+    }
+    return 0;
+}
+
+// Sospende la coroutine corrente fino al prossimo rilascio
+int esecutore_attende_periodo(parametri *tp)
+{
+    coroutine *co = corrente;
+    if (!co || co->tp != tp)
+        return attende_periodo(tp); // Corpo eseguito da un thread di crea_task
+
+    pthread_mutex_lock(mutex_task(tp));
+    struct timespec at = tp->at;
+    int termina = tp->termina;
+    pthread_mutex_unlock(mutex_task(tp));
+    if (termina)
+        return 1;
+
+    struct timespec adesso;
+    clock_gettime(CLOCK_MONOTONIC, &adesso);
+    co->rilascio = at;
+    co->in_ritardo = confronta_istanti(adesso, at) >= 0;
+    swapcontext(&co->contesto, &co->w->principale);
+    return co->termina;
+}
+
+// Termina il task e ne attende la fine
+int esecutore_rimuove_task(esecutore *e, parametri *tp)
+{
+    termina_task(tp);
+    pthread_mutex_lock(&e->mutex);
+    int trovato = 0;
+    for (;;)
+    {
+        coroutine *co = e->tasks;
+        while (co && co->tp != tp)
+            co = co->succ;
+        if (!co)
+            break;
+        trovato = 1;
+        pthread_cond_wait(&e->fine_cond, &e->mutex);
+    }
+    pthread_mutex_unlock(&e->mutex);
+    return trovato ? 0 : -1;
+}
+
+long long esecutore_cambi_contesto(esecutore *e)
+{
+    long long cambi = 0;
+    for (int k = 0; k < e->num_worker; k++)
+        cambi += __atomic_load_n(&e->w[k].cambi, __ATOMIC_RELAXED);
+    return cambi;
+}
+
+// Termina i task, ferma i worker e libera tutto
+void esecutore_distrugge(esecutore *e)
+{
+    if (!e)
+        return;
+    pthread_mutex_lock(&e->mutex);
+    for (coroutine *co = e->tasks; co; co = co->succ)
+        termina_task(co->tp);
+    while (e->tasks)
+        pthread_cond_wait(&e->fine_cond, &e->mutex);
+    pthread_mutex_unlock(&e->mutex);
+
+    for (int k = 0; k < e->num_worker; k++)
+    {
+        worker *w = &e->w[k];
+        pthread_mutex_lock(&w->mutex);
+        w->ferma = 1;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+        pthread_join(w->thread, NULL);
+        free(w->heap);
+        pthread_mutex_destroy(&w->mutex);
+        pthread_cond_destroy(&w->cond);
+    }
+    for (int k = 0; k < e->pool_dim; k++)
+        munmap(e->pool[k], e->dim_stack + e->pagina);
+    free(e->pool);
+    pthread_mutex_destroy(&e->mutex);
+    pthread_cond_destroy(&e->fine_cond);
+    free(e->w);
+    free(e);
+}
@@ -0,0 +1,392 @@
+#define _GNU_SOURCE // sched_getcpu
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "evring.h"
+
+#define EVRING_MAGIC 0x45565247u    // "EVRG"
+#define EVRING_VERSIONE 1
+#define EVRING_CAPACITA_MAX (1 << 20)
+#define EVRING_ATTESE_MAX 30        // Letture (frame) prima di saltare uno slot mai pubblicato
+
+// Slot dell'anello: seq = posizione + 1 quando pubblicato, 0 durante la scrittura
+typedef struct {
+    unsigned long long seq;
+    long long istante_ns;
+    long long at_ns;
+    int task_id;
+    short tipo;
+    short cpu;
+} slot_evento;
+
+// Riga della tabella dei task: parametri fissi e statistiche aggiornate dal lato real-time
+typedef struct {
+    int stato;                 // 0 = libera, 1 = occupata, 2 = task rimosso (riusabile)
+    int id, periodo, deadline, priorita, sched, wcet;
+    int deadperse;
+    long long blocco_max_ns, blocco_tot_ns;
+    long long jitter_max_ns, jitter_tot_ns, rilasci;
+} riga_task;
+
+// Disposizione del segmento condiviso
+typedef struct {
+    unsigned int magic;
+    unsigned int versione;
+    unsigned int capacita;     // Potenza di 2
+    unsigned int incarnazione;
+    int pid;                   // Processo real-time che ha creato il segmento
+    int pronto;                // 1 a inizializzazione completata
+    unsigned long long testa __attribute__((aligned(64))); // Prossima posizione da riservare
+    riga_task task[EVRING_MAX_TASK] __attribute__((aligned(64)));
+    slot_evento slot[];
+} segmento;
+
+struct evring {
+    segmento *s;
+    size_t dimensione;
+    unsigned long long maschera;
+    unsigned long long coda;   // Prossima posizione da leggere (solo lettore)
+    long long persi;
+    int attese;                // Letture consecutive ferme su uno slot non pubblicato
+};
+
+static long long timespec_ns(struct timespec t)
+{
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static struct timespec ns_timespec(long long ns)
+{
+    struct timespec t;
+    t.tv_sec = ns / 1000000000LL;
+    t.tv_nsec = ns % 1000000000LL;
+    return t;
+}
+
+static size_t dimensione_segmento(unsigned int capacita)
+{
+    return sizeof(segmento) + (size_t)capacita * sizeof(slot_evento);
+}
+
+// Incarnazione del segmento lasciato da un processo precedente (0 se non c'è)
+static unsigned int incarnazione_precedente(const char *nome)
+{
+    unsigned int inc = 0;
+    int fd = shm_open(nome, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(segmento))
+    {
+        segmento *s = mmap(NULL, sizeof(segmento), PROT_READ, MAP_SHARED, fd, 0);
+        if (s != MAP_FAILED)
+        {
+            if (s->magic == EVRING_MAGIC)
+                inc = s->incarnazione;
+            munmap(s, sizeof(segmento));
+        }
+    }
+    close(fd);
+    return inc;
+}
+
+// Crea il segmento: quello di un processo precedente viene sostituito con uno nuovo
+// (un visualizzatore ancora collegato al vecchio lo vede senza produttore e si ricollega)
+evring *evring_crea(const char *nome, int capacita)
+{
+    unsigned int cap = 1;
+    if (capacita <= 0)
+        capacita = EVRING_CAPACITA_DEFAULT;
+    if (capacita > EVRING_CAPACITA_MAX)
+        capacita = EVRING_CAPACITA_MAX;
+    while (cap < (unsigned int)capacita)
+        cap <<= 1;
+
+    evring *r = calloc(1, sizeof(evring));
+    if (!r)
+        return NULL;
+    unsigned int inc = incarnazione_precedente(nome) + 1;
+    shm_unlink(nome);
+    int fd = shm_open(nome, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror("evring_crea: shm_open");
+        free(r);
+        return NULL;
+    }
+    r->dimensione = dimensione_segmento(cap);
+    if (ftruncate(fd, (off_t)r->dimensione) < 0)
+    {
+        perror("evring_crea: ftruncate");
+        close(fd);
+        shm_unlink(nome);
+        free(r);
+        return NULL;
+    }
+    r->s = mmap(NULL, r->dimensione, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r->s == MAP_FAILED)
+    {
+        perror("evring_crea: mmap");
+        shm_unlink(nome);
+        free(r);
+        return NULL;
+    }
+    // Il segmento nuovo è già azzerato: testa, tabella e seq degli slot partono da 0
+    r->maschera = cap - 1;
+    r->s->magic = EVRING_MAGIC;
+    r->s->versione = EVRING_VERSIONE;
+    r->s->capacita = cap;
+    // Senza un segmento precedente (rimosso all'uscita) l'incarnazione deve comunque
+    // differire da quella che un visualizzatore ancora collegato ha già visto
+    r->s->incarnazione = inc > 1 ? inc : (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16);
+    r->s->pid = (int)getpid();
+    __atomic_store_n(&r->s->pronto, 1, __ATOMIC_RELEASE);
+    return r;
+}
+
+// Si collega in sola lettura a un segmento esistente
+evring *evring_apri(const char *nome)
+{
+    int fd = shm_open(nome, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    evring *r = calloc(1, sizeof(evring));
+    struct stat st;
+    if (!r || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(segmento))
+    {
+        free(r);
+        close(fd);
+        return NULL;
+    }
+    r->s = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r->s == MAP_FAILED)
+    {
+        free(r);
+        return NULL;
+    }
+    r->dimensione = (size_t)st.st_size;
+    unsigned int cap = r->s->capacita;
+    if (!__atomic_load_n(&r->s->pronto, __ATOMIC_ACQUIRE) || r->s->magic != EVRING_MAGIC ||
+        r->s->versione != EVRING_VERSIONE || cap == 0 || (cap & (cap - 1)) ||
+        dimensione_segmento(cap) > r->dimensione)
+    {
+        evring_chiudi(r);
+        return NULL;
+    }
+    r->maschera = cap - 1;
+    r->coda = __atomic_load_n(&r->s->testa, __ATOMIC_ACQUIRE);
+    return r;
+}
+
+void evring_chiudi(evring *r)
+{
+    if (!r)
+        return;
+    munmap(r->s, r->dimensione);
+    free(r);
+}
+
+void evring_elimina(const char *nome)
+{
+    shm_unlink(nome);
+}
+
+// Riga del task id (la tabella è indirizzata per id con scansione lineare; le righe
+// dei task rimossi non interrompono la scansione e vengono riusate per i task nuovi)
+static riga_task *cerca_riga(segmento *s, int id, int libera)
+{
+    unsigned int h = (unsigned int)id % EVRING_MAX_TASK;
+    riga_task *rimossa = NULL;
+    for (int k = 0; k < EVRING_MAX_TASK; k++)
+    {
+        riga_task *t = &s->task[(h + k) % EVRING_MAX_TASK];
+        int stato = __atomic_load_n(&t->stato, __ATOMIC_ACQUIRE);
+        if (stato == 1 && t->id == id)
+            return t;
+        if (stato == 2 && !rimossa)
+            rimossa = t;
+        if (!stato)
+            return libera ? (rimossa ? rimossa : t) : NULL;
+    }
+    return libera ? rimossa : NULL;
+}
+
+int evring_registra_task(evring *r, const parametri *tp)
+{
+    riga_task *t = cerca_riga(r->s, tp->id, 1);
+    if (!t)
+        return -1;
+    t->id = tp->id;
+    t->periodo = tp->periodo;
+    t->deadline = tp->deadline;
+    t->priorita = tp->priorita;
+    t->sched = tp->sched;
+    t->wcet = tp->wcet;
+    t->deadperse = 0;
+    t->blocco_max_ns = t->blocco_tot_ns = 0;
+    t->jitter_max_ns = t->jitter_tot_ns = t->rilasci = 0;
+    __atomic_store_n(&t->stato, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void evring_rimuovi_task(evring *r, const parametri *tp)
+{
+    riga_task *t = cerca_riga(r->s, tp->id, 0);
+    if (t)
+        __atomic_store_n(&t->stato, 2, __ATOMIC_RELEASE);
+}
+
+// Copia parametri e statistiche del task nella tabella (valori a 64 bit scritti interi).
+// Senza mutex: parametri, jitter e blocchi li scrive solo il contesto del task (thread o
+// coroutine), che è anche chi produce INIZIO e FINE; deadperse cresce anche dal watchdog
+// ed è letto in modo atomico. Un MISS può arrivare dal thread del watchdog: allora si
+// pubblica solo deadperse, il resto della riga si aggiorna alla FINE del job
+static void aggiorna_riga(evring *r, parametri *tp, tipo_notifica tipo)
+{
+    riga_task *t = cerca_riga(r->s, tp->id, 0);
+    if (!t)
+        return;
+    __atomic_store_n(&t->deadperse, __atomic_load_n(&tp->deadperse, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    if (tipo != NOTIFICA_FINE)
+        return;
+    // Parametri compresi: possono cambiare con riconfigura_task (applicata dal task al rilascio)
+    __atomic_store_n(&t->periodo, tp->periodo, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->deadline, tp->deadline, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->priorita, tp->priorita, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->sched, (int)tp->sched, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->wcet, tp->wcet, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->blocco_max_ns, tp->blocco_max_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->blocco_tot_ns, tp->blocco_tot_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->jitter_max_ns, tp->jitter_max_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->jitter_tot_ns, tp->jitter_tot_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->rilasci, tp->rilasci, __ATOMIC_RELAXED);
+}
+
+// Scrive un evento: riserva la posizione, scrive lo slot e lo pubblica (mai bloccante:
+// nessun mutex sul percorso del produttore)
+void evring_scrivi(evring *r, parametri *tp, tipo_notifica tipo)
+{
+    if (!r)
+        return;
+    if (tipo != NOTIFICA_INIZIO)
+        aggiorna_riga(r, tp, tipo);
+
+    struct timespec adesso;
+    clock_gettime(CLOCK_MONOTONIC, &adesso);
+    // at lo scrive solo il task che produce l'INIZIO; agli altri eventi non serve
+    long long at_ns = tipo == NOTIFICA_INIZIO ? timespec_ns(tp->at) : 0;
+
+    unsigned long long pos = __atomic_fetch_add(&r->s->testa, 1, __ATOMIC_RELAXED);
+    slot_evento *e = &r->s->slot[pos & r->maschera];
+    __atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->istante_ns = timespec_ns(adesso);
+    e->at_ns = at_ns;
+    e->task_id = tp->id;
+    e->tipo = (short)tipo;
+    e->cpu = (short)sched_getcpu();
+    __atomic_store_n(&e->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void evring_notifica(void *utente, parametri *tp, tipo_notifica tipo)
+{
+    evring_scrivi((evring *)utente, tp, tipo);
+}
+
+// Legge gli eventi pubblicati; gli slot sovrascritti o mai completati vengono saltati
+int evring_leggi(evring *r, evring_evento *ev, int max)
+{
+    int n = 0;
+    unsigned long long cap = r->maschera + 1;
+    while (n < max)
+    {
+        unsigned long long testa = __atomic_load_n(&r->s->testa, __ATOMIC_ACQUIRE);
+        if (r->coda >= testa)
+            break;
+        if (testa - r->coda > cap)
+        {
+            // Il lettore è rimasto indietro di più di un giro
+            r->persi += (long long)(testa - cap - r->coda);
+            r->coda = testa - cap;
+        }
+        const slot_evento *e = &r->s->slot[r->coda & r->maschera];
+        unsigned long long seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        if (seq != r->coda + 1)
+        {
+            // seq più grande: già sovrascritto da un giro successivo; più piccolo: scrittura
+            // in corso (oppure produttore terminato a metà, e allora dopo qualche frame si salta)
+            if (seq < r->coda + 1 && ++r->attese < EVRING_ATTESE_MAX)
+                break;
+            r->persi++;
+            r->coda++;
+            r->attese = 0;
+            continue;
+        }
+        evring_evento x;
+        x.tipo = (tipo_notifica)e->tipo;
+        x.task_id = e->task_id;
+        x.cpu = e->cpu;
+        x.istante = ns_timespec(e->istante_ns);
+        x.at = ns_timespec(e->at_ns);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        r->coda++;
+        r->attese = 0;
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq)
+        {
+            r->persi++; // Sovrascritto durante la copia
+            continue;
+        }
+        ev[n++] = x;
+    }
+    return n;
+}
+
+long long evring_persi(const evring *r)
+{
+    return r->persi;
+}
+
+unsigned int evring_incarnazione(const evring *r)
+{
+    return r->s->incarnazione;
+}
+
+int evring_produttore_attivo(const evring *r)
+{
+    return kill((pid_t)r->s->pid, 0) == 0 || errno == EPERM;
+}
+
+int evring_task(const evring *r, int i, parametri *tp)
+{
+    if (i < 0 || i >= EVRING_MAX_TASK)
+        return -1;
+    riga_task *t = &r->s->task[i];
+    if (__atomic_load_n(&t->stato, __ATOMIC_ACQUIRE) != 1)
+        return 0;
+    pthread_mutex_lock(mutex_task(tp));
+    tp->id = t->id;
+    tp->periodo = __atomic_load_n(&t->periodo, __ATOMIC_RELAXED);
+    tp->deadline = __atomic_load_n(&t->deadline, __ATOMIC_RELAXED);
+    tp->priorita = __atomic_load_n(&t->priorita, __ATOMIC_RELAXED);
+    tp->sched = (schedulazione)__atomic_load_n(&t->sched, __ATOMIC_RELAXED);
+    tp->wcet = __atomic_load_n(&t->wcet, __ATOMIC_RELAXED);
+    tp->deadperse = __atomic_load_n(&t->deadperse, __ATOMIC_RELAXED);
+    tp->blocco_max_ns = __atomic_load_n(&t->blocco_max_ns, __ATOMIC_RELAXED);
+    tp->blocco_tot_ns = __atomic_load_n(&t->blocco_tot_ns, __ATOMIC_RELAXED);
+    tp->jitter_max_ns = __atomic_load_n(&t->jitter_max_ns, __ATOMIC_RELAXED);
+    tp->jitter_tot_ns = __atomic_load_n(&t->jitter_tot_ns, __ATOMIC_RELAXED);
+    tp->rilasci = __atomic_load_n(&t->rilasci, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(mutex_task(tp));
+    return 1;
+}
@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "risorse.h"
+
+// *** STATO GLOBALE SRP ***
+// Il ceiling di sistema è il massimo dei ceiling delle risorse SRP occupate
+#define SRP_MAX_OCCUPATE 64
+static pthread_mutex_t *srp_mutex = NULL; // Priority inheritance: lo usano i task real-time
+static pthread_once_t srp_once = PTHREAD_ONCE_INIT;
+static pthread_cond_t srp_cond = PTHREAD_COND_INITIALIZER;
+static int srp_occupate[SRP_MAX_OCCUPATE]; // Ceiling delle risorse SRP occupate
+static int srp_num_occupate = 0;
+static volatile int srp_risorse = 0;       // Risorse SRP esistenti (0 = nessun controllo)
+
+static void crea_srp_mutex(void)
+{
+    srp_mutex = crea_mutex_pi();
+    if (!srp_mutex)
+    {
+        fprintf(stderr, "risorse: mutex SRP non creato\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Mutex dello stato SRP, creato al primo uso
+static pthread_mutex_t *srp_lock(void)
+{
+    pthread_once(&srp_once, crea_srp_mutex);
+    return srp_mutex;
+}
+
+// Tempo corrente in nanosecondi
+static long long adesso_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Ceiling di sistema (da chiamare con srp_mutex acquisito)
+static int srp_ceiling_sistema(void)
+{
+    int c = 0;
+    for (int i = 0; i < srp_num_occupate; i++)
+        if (srp_occupate[i] > c)
+            c = srp_occupate[i];
+    return c;
+}
+
+// Livello di prelazione SRP del task
+int livello_prelazione(const parametri *tp)
+{
+    if (tp->sched == FIFO || tp->sched == RR)
+        return tp->priorita;
+    // Deadline relativa più corta = livello più alto
+    return tp->deadline > 0 ? 1000000 / tp->deadline : 1000000;
+}
+
+// Inizializza una risorsa con il protocollo indicato
+int risorsa_init(risorsa *r, protocollo_risorsa protocollo, int ceiling)
+{
+    pthread_mutexattr_t attr;
+    int ret;
+
+    r->protocollo = protocollo;
+    r->ceiling = ceiling > 0 ? ceiling : 0;
+    pthread_mutexattr_init(&attr);
+    switch (protocollo)
+    {
+    case PROTOCOLLO_PCP:
+        // Senza tetto esplicito si parte dalla massima priorità FIFO finché
+        // risorsa_usata_da non dichiara gli utenti effettivi
+        ret = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_PROTECT);
+        if (ret == 0)
+            ret = pthread_mutexattr_setprioceiling(&attr, r->ceiling > 0 ? r->ceiling : sched_get_priority_max(SCHED_FIFO));
+        break;
+    default:
+        // PI e SRP: il mutex eredita comunque la priorità (su più CPU SRP da solo non basta)
+        ret = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+        break;
+    }
+    if (ret == 0)
+        ret = pthread_mutex_init(&r->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (ret == 0 && protocollo == PROTOCOLLO_SRP)
+    {
+        srp_lock(); // Il mutex SRP si crea qui, non al primo job di un task real-time
+        __sync_fetch_and_add(&srp_risorse, 1);
+    }
+    return ret;
+}
+
+// Dichiara che il task tp usa la risorsa
+int risorsa_usata_da(risorsa *r, const parametri *tp)
+{
+    int old;
+    switch (r->protocollo)
+    {
+    case PROTOCOLLO_PCP:
+    {
+        int nuovo = r->ceiling;
+        if (tp->priorita > nuovo)
+            nuovo = tp->priorita;
+        if (nuovo < sched_get_priority_min(SCHED_FIFO))
+            nuovo = sched_get_priority_min(SCHED_FIFO);
+        int ret = pthread_mutex_setprioceiling(&r->mutex, nuovo, &old);
+        if (ret == 0)
+            r->ceiling = nuovo;
+        return ret;
+    }
+    case PROTOCOLLO_SRP:
+        if (livello_prelazione(tp) > r->ceiling)
+            r->ceiling = livello_prelazione(tp);
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+// Acquisisce la risorsa misurando il tempo di blocco
+int risorsa_lock(risorsa *r, parametri *tp)
+{
+    long long t0 = tp ? adesso_ns() : 0;
+    int ret = pthread_mutex_lock(&r->mutex);
+    if (ret)
+        return ret;
+    if (tp)
+        tp->blocco_job_ns += adesso_ns() - t0;
+    if (r->protocollo == PROTOCOLLO_SRP)
+    {
+        pthread_mutex_lock(srp_lock());
+        if (srp_num_occupate < SRP_MAX_OCCUPATE)
+            srp_occupate[srp_num_occupate++] = r->ceiling;
+        pthread_mutex_unlock(srp_lock());
+    }
+    return 0;
+}
+
+// Rilascia la risorsa
+void risorsa_unlock(risorsa *r)
+{
+    if (r->protocollo == PROTOCOLLO_SRP)
+    {
+        pthread_mutex_lock(srp_lock());
+        for (int i = 0; i < srp_num_occupate; i++)
+        {
+            if (srp_occupate[i] == r->ceiling)
+            {
+                srp_occupate[i] = srp_occupate[--srp_num_occupate];
+                break;
+            }
+        }
+        pthread_cond_broadcast(&srp_cond);
+        pthread_mutex_unlock(srp_lock());
+    }
+    pthread_mutex_unlock(&r->mutex);
+}
+
+// Distrugge la risorsa
+void risorsa_distrugge(risorsa *r)
+{
+    pthread_mutex_destroy(&r->mutex);
+    if (r->protocollo == PROTOCOLLO_SRP)
+        __sync_fetch_and_sub(&srp_risorse, 1);
+}
+
+// Blocco SRP all'inizio del job: il tempo atteso conta come blocco del job
+void srp_inizio_job(parametri *tp)
+{
+    if (srp_risorse == 0)
+        return;
+    long long t0 = adesso_ns();
+    int livello = livello_prelazione(tp);
+    pthread_mutex_lock(srp_lock());
+    while (livello <= srp_ceiling_sistema())
+        pthread_cond_wait(&srp_cond, srp_lock());
+    pthread_mutex_unlock(srp_lock());
+    tp->blocco_job_ns += adesso_ns() - t0;
+}
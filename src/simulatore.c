@@ -0,0 +1,553 @@
+#include <stdlib.h>
+#include <string.h>
+#include "simulatore.h"
+
+#define NS_PER_MS 1000000LL
+#define SIM_QUANTO_DEFAULT_MS 100 // Quanto predefinito di SCHED_RR su Linux
+#define SIM_QUANTO_OTHER_MS 3     // Fetta di CFS per OTHER (ordine di sched_min_granularity)
+
+// Classi di scheduling in ordine di precedenza, come nel kernel
+enum { CLASSE_DEADLINE, CLASSE_RT, CLASSE_OTHER };
+
+// Eventi a tempo fisso nella coda (gli altri dipendono da chi è in esecuzione)
+enum { EV_RILASCIO, EV_RICARICA };
+
+typedef struct {
+    long long t;
+    int task;
+    int tipo;
+} evento_coda;
+
+// Stato simulato di un task (tempi in nanosecondi virtuali)
+typedef struct {
+    const parametri *p;
+    sim_statistiche *st;
+    int classe;
+    int rr;                    // Round robin a parità di priorità
+    int cbs;                   // Server CBS (budget e deadline del server)
+    long long periodo, deadline, wcet, esec, offset;
+    unsigned long long ammesse; // CPU virtuali ammesse (bit i = CPU i)
+    long long rilasciati, completati; // Job rilasciati e completati
+    long long rimanente;       // Esecuzione residua del job corrente
+    long long dl_job;          // Deadline assoluta del job corrente
+    long long seq;             // Ordine di arrivo in coda (FIFO/RR a parità di priorità)
+    long long quanto;          // Quanto RR residuo
+    long long quanto_pieno;    // Quanto della classe (RR o fetta OTHER)
+    long long budget, dl_server; // Stato del server CBS
+    int throttled;             // Budget CBS esaurito: attende la ricarica
+    int cpu, ultima_cpu;       // CPU attuale (-1 = non in esecuzione) e precedente
+    int nuova_cpu;             // CPU assegnata dall'ultima rischedulazione
+    int posizione;             // Posizione nell'ordine di priorità corrente
+    long long chiave;          // Chiave di ordinamento dentro la classe
+} sim_task;
+
+// Stato dell'intera simulazione
+typedef struct {
+    sim_task *task;
+    int n;
+    int num_cpu;
+    long long adesso, fine, quanto;
+    long long contatore_seq;
+    evento_coda *coda;         // Min-heap sugli istanti
+    int dim_coda;
+    sim_task **ordine;         // Task attivi ordinati per priorità
+    int *occupata;             // Task in esecuzione su ogni CPU (-1 = libera)
+    int *riservata;            // CPU già assegnate nella rischedulazione corrente
+    const sim_config *cfg;
+    int miss;
+} simulazione;
+
+// *** CODA DEGLI EVENTI ***
+
+static void coda_inserisce(simulazione *s, long long t, int task, int tipo)
+{
+    int i = s->dim_coda++;
+    while (i > 0)
+    {
+        int padre = (i - 1) / 2;
+        if (s->coda[padre].t <= t)
+            break;
+        s->coda[i] = s->coda[padre];
+        i = padre;
+    }
+    s->coda[i] = (evento_coda){t, task, tipo};
+}
+
+static evento_coda coda_estrae(simulazione *s)
+{
+    evento_coda primo = s->coda[0];
+    evento_coda ultimo = s->coda[--s->dim_coda];
+    int i = 0;
+    for (;;)
+    {
+        int figlio = 2 * i + 1;
+        if (figlio >= s->dim_coda)
+            break;
+        if (figlio + 1 < s->dim_coda && s->coda[figlio + 1].t < s->coda[figlio].t)
+            figlio++;
+        if (ultimo.t <= s->coda[figlio].t)
+            break;
+        s->coda[i] = s->coda[figlio];
+        i = figlio;
+    }
+    if (s->dim_coda > 0)
+        s->coda[i] = ultimo;
+    return primo;
+}
+
+// *** EVENTI VERSO IL CHIAMANTE ***
+
+static void emette_risposta(simulazione *s, sim_evento_tipo tipo, const sim_task *t, int cpu,
+                            long long quando, long long risposta)
+{
+    if (!s->cfg->evento)
+        return;
+    sim_evento ev;
+    ev.tipo = tipo;
+    ev.task_id = t->p->id;
+    ev.cpu = cpu;
+    ev.risposta_ns = risposta;
+    ev.deadline_ms = t->p->deadline;
+    ev.istante.tv_sec = quando / (1000 * NS_PER_MS);
+    ev.istante.tv_nsec = quando % (1000 * NS_PER_MS);
+    s->cfg->evento(&ev, s->cfg->utente);
+}
+
+static void emette(simulazione *s, sim_evento_tipo tipo, const sim_task *t, int cpu, long long quando)
+{
+    emette_risposta(s, tipo, t, cpu, quando, 0);
+}
+
+// *** CICLO DI VITA DEI JOB ***
+
+// Il task ha un job da eseguire e non è sospeso dal server CBS
+static int attivo(const sim_task *t)
+{
+    return t->rilasciati > t->completati && !t->throttled;
+}
+
+// Prepara il job corrente; risveglio indica che il task era inattivo
+static void nuovo_job(simulazione *s, sim_task *t, int risveglio)
+{
+    t->rimanente = t->esec;
+    t->dl_job = t->offset + t->completati * t->periodo + t->deadline;
+    if (!risveglio)
+        return; // Job arretrato: il task non si è mai sospeso, resta al suo posto
+    t->seq = ++s->contatore_seq;
+    t->quanto = t->quanto_pieno;
+    if (t->cbs && !t->throttled)
+    {
+        // Regola di risveglio del CBS: il budget residuo si può usare solo se non
+        // supera la banda del server fino alla sua deadline, altrimenti si ricarica
+        long long margine = t->dl_server - s->adesso;
+        if (margine <= 0 || (double)t->budget * t->deadline > (double)margine * t->wcet)
+        {
+            t->dl_server = s->adesso + t->deadline;
+            t->budget = t->wcet;
+        }
+    }
+}
+
+static void rilascio(simulazione *s, int i)
+{
+    sim_task *t = &s->task[i];
+    int era_inattivo = t->rilasciati == t->completati;
+    t->rilasciati++;
+    t->st->job_rilasciati++;
+    emette(s, SIM_RILASCIO, t, -1, s->adesso);
+    if (era_inattivo)
+        nuovo_job(s, t, 1);
+    long long prossimo = t->offset + t->rilasciati * t->periodo;
+    if (prossimo < s->fine)
+        coda_inserisce(s, prossimo, i, EV_RILASCIO);
+}
+
+static void completa(simulazione *s, sim_task *t)
+{
+    long long rilascio_job = t->offset + t->completati * t->periodo;
+    long long risposta = s->adesso - rilascio_job;
+    emette_risposta(s, SIM_FINE, t, t->cpu, s->adesso, risposta);
+    s->occupata[t->cpu] = -1;
+    t->cpu = -1;
+    t->completati++;
+    t->st->job_completati++;
+    t->st->risposta_tot_ns += risposta;
+    if (risposta > t->st->risposta_max_ns)
+        t->st->risposta_max_ns = risposta;
+    // Stessa verifica di deadline_miss: il job è finito dopo la deadline assoluta
+    if (s->adesso > t->dl_job)
+    {
+        t->st->deadperse++;
+        s->miss++;
+        emette(s, SIM_MISS, t, -1, s->adesso);
+    }
+    if (t->rilasciati > t->completati)
+        nuovo_job(s, t, 0);
+}
+
+// *** SCHEDULING ***
+
+// Ordine di priorità: classe, poi chiave (deadline o priorità), poi arrivo, poi id
+static int confronta_task(const void *a, const void *b)
+{
+    const sim_task *x = *(sim_task *const *)a;
+    const sim_task *y = *(sim_task *const *)b;
+    if (x->classe != y->classe)
+        return x->classe - y->classe;
+    if (x->chiave != y->chiave)
+        return x->chiave < y->chiave ? -1 : 1;
+    if (x->seq != y->seq)
+        return x->seq < y->seq ? -1 : 1;
+    return x->p->id - y->p->id;
+}
+
+static int cpu_ammessa(const sim_task *t, int cpu)
+{
+    return (t->ammesse >> cpu) & 1;
+}
+
+// Sceglie i task in esecuzione sulle num_cpu CPU (scheduling globale) ed emette
+// le prelazioni e le partenze rispetto all'assegnamento precedente
+static void rischedula(simulazione *s)
+{
+    int k = 0;
+    for (int i = 0; i < s->n; i++)
+    {
+        sim_task *t = &s->task[i];
+        t->nuova_cpu = -1;
+        t->posizione = -1;
+        if (!attivo(t))
+            continue;
+        if (t->classe == CLASSE_DEADLINE)
+            t->chiave = t->cbs ? t->dl_server : t->dl_job;
+        else if (t->classe == CLASSE_RT)
+            t->chiave = -t->p->priorita; // Priorità più alta = più urgente
+        else
+            t->chiave = 0;
+        s->ordine[k++] = t;
+    }
+    qsort(s->ordine, k, sizeof(sim_task *), confronta_task);
+    for (int j = 0; j < k; j++)
+        s->ordine[j]->posizione = j;
+
+    // Assegnamento goloso in ordine di priorità: ogni task tiene la sua CPU se può,
+    // altrimenti prende la CPU ammessa libera o con l'occupante meno prioritario
+    for (int c = 0; c < s->num_cpu; c++)
+        s->riservata[c] = 0;
+    int assegnate = 0;
+    for (int j = 0; j < k && assegnate < s->num_cpu; j++)
+    {
+        sim_task *t = s->ordine[j];
+        int scelta = -1;
+        if (t->cpu >= 0 && !s->riservata[t->cpu])
+            scelta = t->cpu;
+        else
+        {
+            int peggiore = -1;
+            for (int c = 0; c < s->num_cpu; c++)
+            {
+                if (s->riservata[c] || !cpu_ammessa(t, c))
+                    continue;
+                int occ = s->occupata[c];
+                int rango = occ < 0 ? s->n : s->task[occ].posizione < 0 ? s->n : s->task[occ].posizione;
+                if (rango > peggiore || (rango == peggiore && c == t->ultima_cpu))
+                {
+                    peggiore = rango;
+                    scelta = c;
+                }
+            }
+        }
+        if (scelta >= 0)
+        {
+            s->riservata[scelta] = 1;
+            t->nuova_cpu = scelta;
+            assegnate++;
+        }
+    }
+
+    // Prima chi lascia la CPU, poi chi parte: la timeline vede intervalli disgiunti
+    for (int c = 0; c < s->num_cpu; c++)
+    {
+        int occ = s->occupata[c];
+        if (occ < 0 || s->task[occ].nuova_cpu == c)
+            continue;
+        sim_task *t = &s->task[occ];
+        emette(s, SIM_FINE, t, c, s->adesso);
+        if (attivo(t))
+            t->st->prelazioni++;
+        t->cpu = -1;
+        s->occupata[c] = -1;
+    }
+    for (int j = 0; j < k; j++)
+    {
+        sim_task *t = s->ordine[j];
+        if (t->nuova_cpu < 0 || t->nuova_cpu == t->cpu)
+            continue;
+        if (t->ultima_cpu >= 0 && t->ultima_cpu != t->nuova_cpu)
+            t->st->migrazioni++;
+        t->cpu = t->ultima_cpu = t->nuova_cpu;
+        s->occupata[t->cpu] = (int)(t - s->task);
+        emette(s, SIM_INIZIO, t, t->cpu, s->adesso);
+    }
+}
+
+// *** API ***
+
+static long long mcd(long long a, long long b)
+{
+    while (b)
+    {
+        long long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// Iperperiodo del task set in millisecondi, limitato a SIM_DURATA_MAX_MS
+long long sim_iperperiodo_ms(const parametri *tasks, int n)
+{
+    long long h = 1;
+    for (int i = 0; i < n; i++)
+    {
+        if (tasks[i].periodo <= 0)
+            continue;
+        h = h / mcd(h, tasks[i].periodo) * tasks[i].periodo;
+        if (h >= SIM_DURATA_MAX_MS)
+            return SIM_DURATA_MAX_MS;
+    }
+    return h;
+}
+
+// Imposta classe e parametri di un task secondo la politica simulata
+// (wcet_ns <= 0: il wcet del task in millisecondi)
+static void prepara_task(sim_task *t, const sim_config *cfg, int pct, long long wcet_ns)
+{
+    schedulazione sched = t->p->sched;
+    switch (cfg->politica)
+    {
+    case SIM_FIFO:
+        sched = FIFO;
+        break;
+    case SIM_RR:
+        sched = RR;
+        break;
+    case SIM_EDF:
+    case SIM_CBS:
+        sched = DEADLINE;
+        break;
+    default:
+        break;
+    }
+    t->classe = sched == DEADLINE ? CLASSE_DEADLINE : sched == OTHER ? CLASSE_OTHER : CLASSE_RT;
+    t->rr = sched == RR || sched == OTHER; // OTHER approssimato come RR equo a priorità 0
+    t->cbs = sched == DEADLINE && cfg->politica != SIM_EDF;
+    t->periodo = (long long)t->p->periodo * NS_PER_MS;
+    t->deadline = (long long)t->p->deadline * NS_PER_MS;
+    t->offset = (long long)t->p->offset * NS_PER_MS;
+    t->wcet = wcet_ns > 0 ? wcet_ns : (long long)t->p->wcet * NS_PER_MS;
+    t->esec = t->wcet * pct / 100;
+    if (t->esec <= 0)
+        t->esec = 1;
+    // Maschera limitata alle CPU simulate; se non ne resta nessuna il vincolo si ignora
+    unsigned long long tutte = cfg->num_cpu >= 64 ? ~0ULL : (1ULL << cfg->num_cpu) - 1;
+    t->ammesse = t->p->affinita & tutte;
+    if (!t->ammesse)
+        t->ammesse = tutte;
+    t->cpu = t->ultima_cpu = -1;
+}
+
+// Simula il task set e riempie le statistiche per task
+int simula(const parametri *tasks, int n, const sim_config *cfg, sim_statistiche *stat)
+{
+    if (!tasks || n <= 0 || !cfg || !stat || cfg->num_cpu < 1)
+        return -1;
+    long long offset_max = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (tasks[i].periodo <= 0 || tasks[i].deadline <= 0 || tasks[i].wcet <= 0 || tasks[i].offset < 0)
+            return -1;
+        if (tasks[i].offset > offset_max)
+            offset_max = tasks[i].offset;
+    }
+    int pct = cfg->esecuzione_pct > 0 ? cfg->esecuzione_pct : 100;
+    long long durata_ms = cfg->durata_ms > 0 ? cfg->durata_ms : sim_iperperiodo_ms(tasks, n) + offset_max;
+
+    simulazione s;
+    memset(&s, 0, sizeof(s));
+    s.n = n;
+    s.num_cpu = cfg->num_cpu;
+    s.cfg = cfg;
+    s.fine = durata_ms * NS_PER_MS;
+    s.quanto = (long long)(cfg->quanto_ms > 0 ? cfg->quanto_ms : SIM_QUANTO_DEFAULT_MS) * NS_PER_MS;
+    s.task = calloc(n, sizeof(sim_task));
+    s.coda = malloc(2 * n * sizeof(evento_coda)); // Al più un rilascio e una ricarica per task
+    s.ordine = malloc(n * sizeof(sim_task *));
+    s.occupata = malloc(s.num_cpu * sizeof(int));
+    s.riservata = malloc(s.num_cpu * sizeof(int));
+    if (!s.task || !s.coda || !s.ordine || !s.occupata || !s.riservata)
+    {
+        free(s.task);
+        free(s.coda);
+        free(s.ordine);
+        free(s.occupata);
+        free(s.riservata);
+        return -1;
+    }
+    for (int c = 0; c < s.num_cpu; c++)
+        s.occupata[c] = -1;
+    for (int i = 0; i < n; i++)
+    {
+        sim_task *t = &s.task[i];
+        t->p = &tasks[i];
+        t->st = &stat[i];
+        memset(t->st, 0, sizeof(*t->st));
+        t->st->id = tasks[i].id;
+        prepara_task(t, cfg, pct, cfg->wcet_ns ? cfg->wcet_ns[i] : 0);
+        t->quanto_pieno = t->classe == CLASSE_OTHER ? SIM_QUANTO_OTHER_MS * NS_PER_MS : s.quanto;
+        if (t->offset < s.fine)
+            coda_inserisce(&s, t->offset, i, EV_RILASCIO);
+    }
+
+    for (;;)
+    {
+        // Eventi a tempo fisso che scadono adesso
+        while (s.dim_coda > 0 && s.coda[0].t <= s.adesso)
+        {
+            evento_coda ev = coda_estrae(&s);
+            if (ev.tipo == EV_RILASCIO)
+                rilascio(&s, ev.task);
+            else
+            {
+                // Ricarica CBS: budget pieno e deadline del server spostata di un periodo
+                sim_task *t = &s.task[ev.task];
+                t->throttled = 0;
+                t->budget = t->wcet;
+                t->dl_server += t->periodo;
+            }
+        }
+
+        rischedula(&s);
+
+        // Prossimo istante: evento in coda, fine di un job, quanto o budget esaurito
+        long long prossimo = s.fine;
+        if (s.dim_coda > 0 && s.coda[0].t < prossimo)
+            prossimo = s.coda[0].t;
+        for (int c = 0; c < s.num_cpu; c++)
+        {
+            if (s.occupata[c] < 0)
+                continue;
+            sim_task *t = &s.task[s.occupata[c]];
+            if (s.adesso + t->rimanente < prossimo)
+                prossimo = s.adesso + t->rimanente;
+            if (t->rr && s.adesso + t->quanto < prossimo)
+                prossimo = s.adesso + t->quanto;
+            if (t->cbs && s.adesso + t->budget < prossimo)
+                prossimo = s.adesso + t->budget;
+        }
+        if (prossimo >= s.fine)
+            break;
+
+        long long dt = prossimo - s.adesso;
+        s.adesso = prossimo;
+        for (int c = 0; c < s.num_cpu; c++)
+        {
+            if (s.occupata[c] < 0)
+                continue;
+            sim_task *t = &s.task[s.occupata[c]];
+            t->rimanente -= dt;
+            if (t->rr)
+                t->quanto -= dt;
+            if (t->cbs)
+                t->budget -= dt;
+            if (t->rimanente <= 0)
+                completa(&s, t);
+            else if (t->cbs && t->budget <= 0)
+            {
+                // Budget esaurito a job non finito: sospeso fino al periodo successivo del server
+                t->throttled = 1;
+                coda_inserisce(&s, t->dl_server - t->deadline + t->periodo, (int)(t - s.task), EV_RICARICA);
+            }
+            else if (t->rr && t->quanto <= 0)
+            {
+                // Quanto esaurito: in fondo alla coda della sua priorità
+                t->quanto = t->quanto_pieno;
+                t->seq = ++s.contatore_seq;
+            }
+        }
+    }
+
+    // Chiusura: intervalli ancora aperti e job scaduti mai completati
+    s.adesso = s.fine;
+    for (int c = 0; c < s.num_cpu; c++)
+        if (s.occupata[c] >= 0)
+            emette(&s, SIM_FINE, &s.task[s.occupata[c]], c, s.fine);
+    for (int i = 0; i < n; i++)
+    {
+        sim_task *t = &s.task[i];
+        for (long long k = t->completati; k < t->rilasciati; k++)
+        {
+            if (t->offset + k * t->periodo + t->deadline > s.fine)
+                break;
+            t->st->deadperse++;
+            s.miss++;
+            emette(&s, SIM_MISS, t, -1, s.fine);
+        }
+    }
+
+    free(s.task);
+    free(s.coda);
+    free(s.ordine);
+    free(s.occupata);
+    free(s.riservata);
+    return s.miss;
+}
+
+// Controllo di ammissione: simulazione del task set con la modifica applicata
+int sim_ammissione(const parametri *tp, const modifica_task *m, void *utente)
+{
+    const sim_insieme *ins = utente;
+    if (!ins || !ins->tasks || ins->n <= 0)
+        return -1;
+    parametri *copia = malloc(ins->n * sizeof(parametri));
+    sim_statistiche *stat = malloc(ins->n * sizeof(sim_statistiche));
+    if (!copia || !stat)
+    {
+        free(copia);
+        free(stat);
+        return -1;
+    }
+    for (int i = 0; i < ins->n; i++)
+    {
+        parametri *orig = &ins->tasks[i];
+        pthread_mutex_lock(mutex_task(orig));
+        copia[i] = *orig;
+        pthread_mutex_unlock(mutex_task(orig));
+        // Le modifiche già accettate ma non ancora applicate contano come applicate
+        const modifica_task *mi = orig == tp ? m : copia[i].modifica_pendente ? &copia[i].modifica : NULL;
+        if (mi)
+        {
+            copia[i].periodo = mi->periodo;
+            copia[i].deadline = mi->deadline;
+            copia[i].wcet = mi->wcet;
+            copia[i].priorita = mi->priorita;
+            copia[i].sched = mi->sched;
+        }
+    }
+    sim_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.num_cpu = ins->num_cpu;
+    cfg.politica = SIM_PER_TASK;
+    int offset_max = 0;
+    for (int i = 0; i < ins->n; i++)
+        if (copia[i].offset > offset_max)
+            offset_max = copia[i].offset;
+    long long limite = ins->durata_ms > 0 ? ins->durata_ms : SIM_AMMISSIONE_DURATA_MS;
+    cfg.durata_ms = sim_iperperiodo_ms(copia, ins->n) + offset_max;
+    if (cfg.durata_ms > limite)
+        cfg.durata_ms = limite;
+    int miss = simula(copia, ins->n, &cfg, stat);
+    free(copia);
+    free(stat);
+    return miss < 0 ? -1 : miss > 0;
+}
@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "stress.h"
+#include "simulatore.h"
+
+// Periodi ammessi: divisori di 1000 ms, così l'iperperiodo resta al più 1 s
+static const int periodi[] = {10, 20, 25, 40, 50, 100, 125, 200, 250, 500, 1000};
+#define NUM_PERIODI ((int)(sizeof(periodi) / sizeof(periodi[0])))
+
+static const char *nomi_politica[] = {"OTHER", "FIFO", "RR", "DEADLINE"};
+#define NUM_POLITICHE 4
+
+// Tempi di risposta normalizzati (R / D) raccolti dalla callback del simulatore
+typedef struct {
+    double *valori;
+    long n, cap;
+    long long miss;            // Eventi SIM_MISS (job finiti in ritardo o mai finiti)
+    long long tardivi;         // Job finiti dopo la deadline
+    int errore;
+} campioni;
+
+// Numero casuale in (0, 1)
+static double casuale(unsigned int *seme)
+{
+    return (rand_r(seme) + 1.0) / ((double)RAND_MAX + 2.0);
+}
+
+// Genera n task con UUniFast e priorità rate monotonic
+double stress_genera(parametri *tasks, long long *wcet_ns, int n, double u, schedulazione sched, unsigned int *seme)
+{
+    double *ut = malloc(n * sizeof(double));
+    int valido = 0;
+    // UUniFast-discard: con u > 1 (più CPU) un task può superare 1 e l'insieme va rigenerato
+    for (int tentativo = 0; ut && tentativo < 1000 && !valido; tentativo++)
+    {
+        double somma = u;
+        valido = 1;
+        for (int i = 0; i < n - 1; i++)
+        {
+            double prossima = somma * pow(casuale(seme), 1.0 / (n - i - 1));
+            ut[i] = somma - prossima;
+            somma = prossima;
+            if (ut[i] > 1.0)
+                valido = 0;
+        }
+        ut[n - 1] = somma;
+        if (ut[n - 1] > 1.0)
+            valido = 0;
+    }
+    double effettiva = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        parametri *tp = &tasks[i];
+        memset(tp, 0, sizeof(*tp));
+        double ui = valido ? ut[i] : u / n; // Ripiego: utilizzazione uniforme
+        if (ui > 1.0)
+            ui = 1.0;
+        tp->id = i + 1;
+        tp->periodo = periodi[rand_r(seme) % NUM_PERIODI];
+        tp->deadline = tp->periodo;
+        // Al millisecondo un task da 0.09 ms diventerebbe da 1 ms (11 volte tanto):
+        // il WCET esatto è in nanosecondi, wcet in ms serve solo fuori dal simulatore
+        long long c = llround(ui * tp->periodo * 1e6);
+        if (c < 1)
+            c = 1;
+        tp->wcet = (int)((c + 999999) / 1000000);
+        if (wcet_ns)
+            wcet_ns[i] = c;
+        effettiva += wcet_ns ? (double)c / (tp->periodo * 1e6) : (double)tp->wcet / tp->periodo;
+        tp->sched = sched;
+        tp->priorita_fissa = 1;
+    }
+    free(ut);
+    // Rate monotonic: periodo più corto = priorità più alta (a parità vince l'indice minore)
+    for (int i = 0; i < n; i++)
+    {
+        if (sched != FIFO && sched != RR)
+            continue;
+        int rango = 0;
+        for (int j = 0; j < n; j++)
+            if (tasks[j].periodo < tasks[i].periodo || (tasks[j].periodo == tasks[i].periodo && j < i))
+                rango++;
+        tasks[i].priorita = rango < 98 ? 99 - rango : 1;
+    }
+    return effettiva;
+}
+
+// Aggiunge un tempo di risposta normalizzato
+static void aggiunge(campioni *c, double v)
+{
+    if (c->errore)
+        return;
+    if (c->n == c->cap)
+    {
+        long cap = c->cap ? 2 * c->cap : 4096;
+        double *v = realloc(c->valori, cap * sizeof(double));
+        if (!v)
+        {
+            c->errore = 1;
+            return;
+        }
+        c->valori = v;
+        c->cap = cap;
+    }
+    c->valori[c->n++] = v;
+}
+
+static void raccoglie(const sim_evento *ev, void *utente)
+{
+    campioni *c = utente;
+    if (ev->tipo == SIM_MISS)
+        c->miss++;
+    if (ev->tipo != SIM_FINE || ev->risposta_ns <= 0)
+        return;
+    if (ev->risposta_ns > ev->deadline_ms * 1000000LL)
+        c->tardivi++;
+    aggiunge(c, ev->risposta_ns / (ev->deadline_ms * 1e6));
+}
+
+static int confronta_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const campioni *c, double p)
+{
+    if (c->n == 0)
+        return 0.0;
+    return c->valori[(long)(p * (c->n - 1))];
+}
+
+// Esegue la rampa per tutte le politiche
+int stress_esegui(const stress_config *cfg, FILE *csv)
+{
+    stress_config k = *cfg;
+    if (k.num_cpu <= 0)
+        k.num_cpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (k.num_cpu <= 0)
+        k.num_cpu = 1;
+    if (k.num_task <= 0)
+        k.num_task = 10;
+    if (k.insiemi <= 0)
+        k.insiemi = 20;
+    if (k.iperperiodi <= 0)
+        k.iperperiodi = 5;
+    if (k.u_max <= 0)
+        k.u_max = k.num_cpu;
+    if (k.passo <= 0)
+        k.passo = 0.05 * k.num_cpu;
+    if (k.u_min <= 0)
+        k.u_min = k.passo;
+
+    parametri *tasks = malloc(k.num_task * sizeof(parametri));
+    long long *wcet_ns = malloc(k.num_task * sizeof(long long));
+    sim_statistiche *stat = malloc(k.num_task * sizeof(sim_statistiche));
+    if (!tasks || !wcet_ns || !stat)
+    {
+        free(tasks);
+        free(wcet_ns);
+        free(stat);
+        return -1;
+    }
+    campioni c = {NULL, 0, 0, 0, 0, 0};
+    double breakdown[NUM_POLITICHE];
+    int rotta[NUM_POLITICHE] = {0};
+    for (int p = 0; p < NUM_POLITICHE; p++)
+        breakdown[p] = 0.0;
+
+    if (csv)
+        fprintf(csv, "politica,utilizzazione,u_effettiva,insiemi,insiemi_ok,miss_ratio,non_finiti,r50,r95,r99,r_max\n");
+    int livello = 0;
+    for (double u = k.u_min; u <= k.u_max + 1e-9; u += k.passo, livello++)
+    {
+        for (int p = 0; p < NUM_POLITICHE; p++)
+        {
+            long long job = 0, miss = 0;
+            int ok = 0, simulati = 0;
+            double somma_u = 0.0;
+            c.n = 0;
+            c.miss = c.tardivi = 0;
+            for (int s = 0; s < k.insiemi; s++)
+            {
+                // Stesso seme per tutte le politiche: si confrontano gli stessi insiemi
+                unsigned int seme = k.seme + (unsigned int)livello * 1000003u + (unsigned int)s;
+                double ue = stress_genera(tasks, wcet_ns, k.num_task, u, (schedulazione)p, &seme);
+                sim_config sc = {0};
+                sc.num_cpu = k.num_cpu;
+                sc.politica = SIM_PER_TASK;
+                sc.durata_ms = k.iperperiodi * sim_iperperiodo_ms(tasks, k.num_task);
+                sc.wcet_ns = wcet_ns;
+                sc.evento = raccoglie;
+                sc.utente = &c;
+                int m = simula(tasks, k.num_task, &sc, stat);
+                if (m < 0)
+                    continue;
+                simulati++;
+                somma_u += ue;
+                if (m == 0)
+                    ok++;
+                miss += m;
+                for (int i = 0; i < k.num_task; i++)
+                    job += stat[i].job_rilasciati;
+            }
+            // I job scaduti e mai finiti entrano nei percentili con risposta infinita:
+            // contando solo i job completati un livello in sovraccarico sembrerebbe migliore
+            long long non_finiti = c.miss - c.tardivi;
+            for (long long j = 0; j < non_finiti; j++)
+                aggiunge(&c, INFINITY);
+            if (c.errore)
+                break;
+            qsort(c.valori, c.n, sizeof(double), confronta_double);
+            double effettiva = simulati ? somma_u / simulati : u;
+            if (csv)
+                fprintf(csv, "%s,%.3f,%.3f,%d,%d,%.6f,%lld,%.4f,%.4f,%.4f,%.4f\n", nomi_politica[p], u, effettiva,
+                        k.insiemi, ok, job ? (double)miss / job : 0.0, non_finiti, percentile(&c, 0.50),
+                        percentile(&c, 0.95), percentile(&c, 0.99), percentile(&c, 1.0));
+            // Breakdown: ultimo livello prima del primo in cui meno di metà degli insiemi è
+            // schedulabile, espresso con l'utilizzazione effettivamente generata
+            if (!rotta[p])
+            {
+                if (2 * ok >= k.insiemi)
+                    breakdown[p] = effettiva;
+                else
+                    rotta[p] = 1;
+            }
+        }
+        if (c.errore)
+            break;
+    }
+
+    int esito = c.errore ? -1 : 0;
+    if (esito == 0)
+    {
+        printf("==== Utilizzazione di breakdown (%d CPU, %d task, %d insiemi per livello) ====\n",
+               k.num_cpu, k.num_task, k.insiemi);
+        for (int p = 0; p < NUM_POLITICHE; p++)
+            printf("%-9s %.3f%s\n", nomi_politica[p], breakdown[p], rotta[p] ? "" : " (nessun cedimento nella rampa)");
+    }
+    free(c.valori);
+    free(tasks);
+    free(wcet_ns);
+    free(stat);
+    return esito;
+}
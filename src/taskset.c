@@ -0,0 +1,276 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "taskset.h"
+
+// Numero di campi per riga
+#define TASKSET_CAMPI 8
+
+// Cursore di lettura sul file mappato in memoria (non terminato da '\0')
+typedef struct {
+    const char *p;
+    const char *fine;
+    int riga;
+} cursore;
+
+// Salta spazi e tabulazioni (non i fine riga)
+static void salta_spazi(cursore *c)
+{
+    while (c->p < c->fine && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r'))
+        c->p++;
+}
+
+// Salta fino all'inizio della riga successiva
+static void salta_riga(cursore *c)
+{
+    while (c->p < c->fine && *c->p != '\n')
+        c->p++;
+    if (c->p < c->fine)
+        c->p++;
+    c->riga++;
+}
+
+// Vero se il cursore è a fine riga (o a inizio commento)
+static int fine_riga(cursore *c)
+{
+    return c->p >= c->fine || *c->p == '\n' || *c->p == '#';
+}
+
+// Legge una parola (sequenza di caratteri non spazio)
+static int leggi_parola(cursore *c, char *buf, size_t len)
+{
+    salta_spazi(c);
+    size_t n = 0;
+    while (c->p < c->fine && *c->p != ' ' && *c->p != '\t' && *c->p != '\r' && *c->p != '\n' && *c->p != '#')
+    {
+        if (n + 1 < len)
+            buf[n++] = *c->p;
+        c->p++;
+    }
+    buf[n] = '\0';
+    return n > 0;
+}
+
+// Converte una parola in intero (ritorna 0 se non è un intero valido)
+static int parola_intero(const char *s, int *val)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (errno || *end != '\0' || end == s || v < -2147483647L || v > 2147483647L)
+        return 0;
+    *val = (int)v;
+    return 1;
+}
+
+// Converte il nome della politica (o il suo numero)
+static int parola_politica(const char *s, schedulazione *sched)
+{
+    static const char *nomi[] = {"OTHER", "FIFO", "RR", "DEADLINE"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (strcasecmp(s, nomi[i]) == 0)
+        {
+            *sched = (schedulazione)i;
+            return 1;
+        }
+    }
+    int v;
+    if (parola_intero(s, &v) && v >= OTHER && v <= DEADLINE)
+    {
+        *sched = (schedulazione)v;
+        return 1;
+    }
+    return 0;
+}
+
+// Controlla la coerenza dei parametri di un task (ritorna il motivo dell'errore o NULL)
+static const char *valida_task(const parametri *tp, int cpu, long num_cpu)
+{
+    if (tp->id <= 0)
+        return "id deve essere positivo";
+    if (tp->periodo <= 0)
+        return "periodo deve essere positivo";
+    if (tp->deadline <= 0)
+        return "deadline deve essere positiva";
+    if (tp->wcet <= 0)
+        return "wcet deve essere positivo";
+    if (tp->wcet > tp->deadline)
+        return "wcet maggiore della deadline";
+    if (tp->sched == DEADLINE && tp->deadline > tp->periodo)
+        return "SCHED_DEADLINE richiede deadline <= periodo";
+    if (tp->sched == FIFO || tp->sched == RR)
+    {
+        int policy = tp->sched == FIFO ? SCHED_FIFO : SCHED_RR;
+        if (tp->priorita < sched_get_priority_min(policy) || tp->priorita > sched_get_priority_max(policy))
+            return "priorita fuori dall'intervallo della politica";
+    }
+    else if (tp->priorita < 0)
+        return "priorita negativa";
+    if (cpu < -1 || cpu >= num_cpu || cpu >= 64)
+        return "affinita oltre il numero di CPU";
+    if (tp->offset < 0)
+        return "offset negativo";
+    return NULL;
+}
+
+// Ordinamento degli id (per trovare i duplicati)
+static int confronta_id(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// Carica e valida l'intero task set
+int taskset_carica(const char *percorso, parametri **tasks, char *err, size_t errlen)
+{
+    *tasks = NULL;
+    int fd = open(percorso, O_RDONLY);
+    if (fd < 0)
+    {
+        snprintf(err, errlen, "%s: %s", percorso, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        snprintf(err, errlen, "%s: %s", percorso, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0)
+    {
+        snprintf(err, errlen, "%s: file vuoto", percorso);
+        close(fd);
+        return -1;
+    }
+    const char *dati = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dati == MAP_FAILED)
+    {
+        snprintf(err, errlen, "%s: mmap: %s", percorso, strerror(errno));
+        return -1;
+    }
+    madvise((void *)dati, st.st_size, MADV_SEQUENTIAL);
+
+    // Prima passata: conta le righe per dimensionare l'array una volta sola
+    int capacita = 1;
+    for (off_t i = 0; i < st.st_size; i++)
+        if (dati[i] == '\n')
+            capacita++;
+    parametri *set = calloc(capacita, sizeof(parametri));
+    if (!set)
+    {
+        snprintf(err, errlen, "%s: memoria insufficiente", percorso);
+        munmap((void *)dati, st.st_size);
+        return -1;
+    }
+
+    long num_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cursore c = {dati, dati + st.st_size, 1};
+    int n = 0;
+    int esito = 0;
+    while (c.p < c.fine)
+    {
+        salta_spazi(&c);
+        if (fine_riga(&c))
+        {
+            salta_riga(&c);
+            continue;
+        }
+        char campo[TASKSET_CAMPI][32];
+        int letti = 0;
+        while (letti < TASKSET_CAMPI && leggi_parola(&c, campo[letti], sizeof(campo[letti])))
+            letti++;
+        salta_spazi(&c);
+        if (letti < TASKSET_CAMPI || !fine_riga(&c))
+        {
+            snprintf(err, errlen, "%s:%d: attesi %d campi (id periodo deadline wcet priorita politica affinita offset)",
+                     percorso, c.riga, TASKSET_CAMPI);
+            esito = -1;
+            break;
+        }
+        parametri *tp = &set[n];
+        int cpu = -1;
+        int ok = parola_intero(campo[0], &tp->id) && parola_intero(campo[1], &tp->periodo) &&
+                 parola_intero(campo[2], &tp->deadline) && parola_intero(campo[3], &tp->wcet) &&
+                 parola_intero(campo[4], &tp->priorita) && parola_politica(campo[5], &tp->sched) &&
+                 parola_intero(campo[6], &cpu) && parola_intero(campo[7], &tp->offset);
+        const char *motivo = ok ? valida_task(tp, cpu, num_cpu) : "campo non numerico o politica sconosciuta";
+        if (motivo)
+        {
+            snprintf(err, errlen, "%s:%d: %s", percorso, c.riga, motivo);
+            esito = -1;
+            break;
+        }
+        tp->affinita = cpu >= 0 ? 1ULL << cpu : 0;
+        tp->priorita_fissa = 1; // La priorità del file non va sostituita da crea_task
+        n++;
+        salta_riga(&c);
+    }
+    munmap((void *)dati, st.st_size);
+
+    if (esito == 0 && n == 0)
+    {
+        snprintf(err, errlen, "%s: nessun task nel file", percorso);
+        esito = -1;
+    }
+    if (esito == 0)
+    {
+        // Id duplicati: si controllano su una copia ordinata degli id
+        int *ids = malloc(n * sizeof(int));
+        if (!ids)
+        {
+            snprintf(err, errlen, "%s: memoria insufficiente", percorso);
+            esito = -1;
+        }
+        else
+        {
+            for (int i = 0; i < n; i++)
+                ids[i] = set[i].id;
+            qsort(ids, n, sizeof(int), confronta_id);
+            for (int i = 1; i < n; i++)
+            {
+                if (ids[i] == ids[i - 1])
+                {
+                    snprintf(err, errlen, "%s: id %d duplicato", percorso, ids[i]);
+                    esito = -1;
+                    break;
+                }
+            }
+            free(ids);
+        }
+    }
+    if (esito < 0)
+    {
+        free(set);
+        return -1;
+    }
+    *tasks = set;
+    return n;
+}
+
+// Libera un task set restituito da taskset_carica
+void taskset_libera(parametri *tasks)
+{
+    free(tasks);
+}
+
+// Imposta per tutti i task un istante di partenza comune
+void taskset_rilascio_sincrono(parametri *tasks, int n, int ritardo_ms)
+{
+    struct timespec partenza;
+    clock_gettime(CLOCK_MONOTONIC, &partenza);
+    aggiunge_millisecondi(&partenza, ritardo_ms);
+    for (int i = 0; i < n; i++)
+        copia_istante(&tasks[i].rilascio, partenza);
+}
@@ -1,4 +1,4 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,12 +6,15 @@
 #include <pthread.h>
 #include <time.h>
 #include <string.h>
-#include <allegro5/allegro.h>
 #include "time0.h"
-#include "bouncing_balls.h"
+#include "risorse.h"
+#include "watchdog.h"
+#include "contatori.h"
+#include "strumenti.h"
 #include <unistd.h>         
 #include <stdint.h>
 #include <sys/syscall.h>    
+#include <sys/prctl.h>
 long int syscall(long int number, ...);
 
 // --- AGGIUNGI QUI la struct e la funzione, SOLO UNA VOLTA ---
@@ -34,6 +37,11 @@ struct sched_attr {
 #define SCHED_DEADLINE 6
 #endif
 
+static int sched_setattr(pid_t pid, struct sched_attr *attr, unsigned int flags)
+{
+    return syscall(__NR_sched_setattr, pid, attr, flags);
+}
+
 // --- FINE AGGIUNTA ---
 
 #define handle_error_en(en, msg) \
@@ -44,8 +52,36 @@ struct sched_attr {
         exit(EXIT_FAILURE);      \
     } while (0)
 
-// Mutex globale dichiarato esternamente, usato per sincronizzare l'accesso ai dati dei task
-extern ALLEGRO_MUTEX *task_mutex;
+// Crea un mutex con protocollo PTHREAD_PRIO_INHERIT (NULL in caso di errore)
+pthread_mutex_t *crea_mutex_pi(void)
+{
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    if (!m)
+        return NULL;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    int ret = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    if (ret == 0)
+        ret = pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (ret)
+    {
+        errno = ret;
+        perror("crea_mutex_pi");
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+// Distrugge un mutex creato con crea_mutex_pi
+void distrugge_mutex(pthread_mutex_t *m)
+{
+    if (!m)
+        return;
+    pthread_mutex_destroy(m);
+    free(m);
+}
 
 // Funzione di utilità per ottenere il tempo corrente in secondi (solo per debug/log)
 static double get_time_seconds()
@@ -89,64 +125,438 @@ void aggiunge_millisecondi(struct timespec *t, int ms)
     }
 }
 
+static pthread_mutex_t *mutex_predefinito = NULL;
+static pthread_once_t mutex_predefinito_once = PTHREAD_ONCE_INIT;
+
+static void crea_mutex_predefinito(void)
+{
+    mutex_predefinito = crea_mutex_pi();
+    if (!mutex_predefinito)
+        handle_error_en(ENOMEM, "time0_mutex");
+}
+
+// Mutex predefinito (priority inheritance), creato al primo uso
+pthread_mutex_t *time0_mutex(void)
+{
+    pthread_once(&mutex_predefinito_once, crea_mutex_predefinito);
+    return mutex_predefinito;
+}
+
+// Mutex che protegge i parametri del task
+pthread_mutex_t *mutex_task(parametri *tp)
+{
+    return tp->lock ? tp->lock : time0_mutex();
+}
+
+// Parametri della modalità di rilascio ibrida
+#define MARGINE_INIZIALE_NS 100000LL  // Margine di partenza prima di avere misure
+#define MARGINE_MIN_NS 5000LL
+#define MARGINE_MAX_NS 2000000LL
+
+static _Thread_local int slack_minimo = 0; // Timer slack del thread già portato al minimo
+
+static long long differenza_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+// Attende l'istante t nel modo del task e ritorna il ritardo del rilascio effettivo in ns
+// (-1 se t è già passato: job in ritardo, nessun risveglio da misurare)
+static long long attende_rilascio(parametri *tp, modo_rilascio modo, const struct timespec *t)
+{
+    struct timespec adesso;
+    clock_gettime(CLOCK_MONOTONIC, &adesso);
+    if (confronta_istanti(adesso, *t) >= 0)
+        return -1;
+    if (modo != RILASCIO_IBRIDO)
+    {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, t, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+        return differenza_ns(&adesso, t);
+    }
+    if (!slack_minimo)
+    {
+        // Senza slack il kernel non accorpa il risveglio con altri timer (default 50 us)
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+        slack_minimo = 1;
+    }
+    if (tp->margine_ns <= 0)
+        tp->margine_ns = MARGINE_INIZIALE_NS;
+
+    // Sleep fino ad at - margine, misurando quanto tardi arriva il risveglio
+    struct timespec sveglia = *t;
+    sveglia.tv_nsec -= tp->margine_ns % 1000000000LL;
+    sveglia.tv_sec -= tp->margine_ns / 1000000000LL;
+    if (sveglia.tv_nsec < 0)
+    {
+        sveglia.tv_nsec += 1000000000LL;
+        sveglia.tv_sec--;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sveglia, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &adesso);
+    long long latenza = differenza_ns(&adesso, &sveglia);
+
+    // Attesa attiva fino all'istante esatto
+    while (confronta_istanti(adesso, *t) < 0)
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+
+    // Auto-regolazione: la stima sale subito ai picchi e scende lentamente;
+    // il margine è il doppio della stima, così un risveglio tardivo resta raro
+    if (latenza > 0 && latenza < MARGINE_MAX_NS)
+    {
+        if (latenza > tp->latenza_ns)
+            tp->latenza_ns = latenza;
+        else
+            tp->latenza_ns -= (tp->latenza_ns - latenza) / 16;
+    }
+    long long margine = 2 * tp->latenza_ns;
+    tp->margine_ns = margine < MARGINE_MIN_NS ? MARGINE_MIN_NS : margine > MARGINE_MAX_NS ? MARGINE_MAX_NS : margine;
+    return differenza_ns(&adesso, t);
+}
+
+// Accumula il ritardo di un rilascio (da chiamare con il mutex del task acquisito)
+static void registra_jitter(parametri *tp, long long ritardo)
+{
+    if (ritardo < 0)
+        return;
+    if (ritardo > tp->jitter_max_ns)
+        tp->jitter_max_ns = ritardo;
+    tp->jitter_tot_ns += ritardo;
+    tp->rilasci++;
+}
+
+// Politica POSIX corrispondente (DEADLINE non ha una politica POSIX: -1)
+static int politica_posix(schedulazione sched)
+{
+    switch (sched)
+    {
+    case FIFO:
+        return SCHED_FIFO;
+    case RR:
+        return SCHED_RR;
+    case DEADLINE:
+        return -1;
+    default:
+        return SCHED_OTHER;
+    }
+}
+
+// Verifica i parametri di una modifica (NULL se validi, altrimenti il motivo)
+static const char *valida_modifica(const modifica_task *m)
+{
+    if (m->periodo <= 0 || m->deadline <= 0)
+        return "periodo e deadline devono essere positivi";
+    if (m->wcet < 0 || m->wcet > m->deadline)
+        return "wcet negativo o maggiore della deadline";
+    if (m->sched == DEADLINE && (m->deadline > m->periodo || m->wcet <= 0))
+        return "SCHED_DEADLINE richiede 0 < wcet <= deadline <= periodo";
+    if (m->sched == FIFO || m->sched == RR)
+    {
+        int policy = politica_posix(m->sched);
+        if (m->priorita < sched_get_priority_min(policy) || m->priorita > sched_get_priority_max(policy))
+            return "priorita fuori dall'intervallo della politica";
+    }
+    return NULL;
+}
+
+// Registra una modifica da applicare al prossimo rilascio del task
+int riconfigura_task(parametri *tp, const modifica_task *m, ammissione_fn ammissione, void *utente)
+{
+    const char *motivo = valida_modifica(m);
+    if (motivo)
+    {
+        fprintf(stderr, "Task %d: modifica non valida: %s\n", tp->id, motivo);
+        return -1;
+    }
+    if (ammissione)
+    {
+        int esito = ammissione(tp, m, utente);
+        if (esito < 0)
+            return -3; // Controllo non eseguibile: la modifica non è né accettata né rifiutata
+        if (esito > 0)
+            return -2;
+    }
+    pthread_mutex_lock(mutex_task(tp));
+    tp->modifica = *m;
+    tp->modifica_pendente = 1;
+    pthread_mutex_unlock(mutex_task(tp));
+    return 0;
+}
+
+// Reimposta politica e priorità del thread corrente (thread del task)
+static int applica_scheduling(const modifica_task *m)
+{
+    if (m->sched == DEADLINE)
+    {
+        struct sched_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.sched_policy = SCHED_DEADLINE;
+        attr.sched_runtime = (uint64_t)m->wcet * 1000000ULL;
+        attr.sched_deadline = (uint64_t)m->deadline * 1000000ULL;
+        attr.sched_period = (uint64_t)m->periodo * 1000000ULL;
+        return sched_setattr(0, &attr, 0) < 0 ? errno : 0;
+    }
+    struct sched_param param;
+    param.sched_priority = m->sched == OTHER ? 0 : m->priorita;
+    return pthread_setschedparam(pthread_self(), politica_posix(m->sched), &param);
+}
+
+// Applica la modifica in attesa, se c'è (dal thread del task, al rilascio).
+// Con cambia_thread = 0 (thread condiviso da più task) politica e priorità restano invariate
+static void applica_modifica(parametri *tp, int cambia_thread)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    if (!tp->modifica_pendente)
+    {
+        pthread_mutex_unlock(mutex_task(tp));
+        return;
+    }
+    modifica_task m = tp->modifica;
+    tp->modifica_pendente = 0;
+    int politica_cambiata = cambia_thread &&
+                            (m.sched != tp->sched || m.priorita != tp->priorita ||
+                             (m.sched == DEADLINE && (m.wcet != tp->wcet || m.deadline != tp->deadline ||
+                                                      m.periodo != tp->periodo)));
+    pthread_mutex_unlock(mutex_task(tp));
+
+    // Se il sistema rifiuta la nuova politica (es. permessi) restano politica e priorità attuali
+    int ret = politica_cambiata ? applica_scheduling(&m) : 0;
+    if (ret)
+    {
+        errno = ret;
+        perror("riconfigura_task");
+    }
+
+    pthread_mutex_lock(mutex_task(tp));
+    tp->periodo = m.periodo;
+    tp->deadline = m.deadline;
+    tp->wcet = m.wcet;
+    if (!ret && cambia_thread)
+    {
+        tp->sched = m.sched;
+        tp->priorita = m.sched == OTHER ? 0 : m.priorita;
+    }
+    pthread_mutex_unlock(mutex_task(tp));
+}
+
 // Imposta il periodo iniziale e la deadline assoluta di un task
 void set_period(parametri *tp)
 {
-    al_lock_mutex(task_mutex);  // Protegge l'accesso ai dati del task
     struct timespec t;
-    clock_gettime(CLOCK_MONOTONIC, &t);
+    long long ritardo = -1; // Ritardo del primo rilascio (solo con partenza sincrona)
+    if (tp->rilascio.tv_sec != 0)
+    {
+        // Partenza sincrona: il primo job parte a rilascio + offset per tutti i task
+        copia_istante(&t, tp->rilascio);
+        aggiunge_millisecondi(&t, tp->offset);
+        pthread_mutex_lock(mutex_task(tp));
+        modo_rilascio modo = tp->attesa;
+        pthread_mutex_unlock(mutex_task(tp));
+        ritardo = attende_rilascio(tp, modo, &t);
+    }
+    else
+        clock_gettime(CLOCK_MONOTONIC, &t);
+    pthread_mutex_lock(mutex_task(tp));  // Protegge l'accesso ai dati del task
+    STRUMENTO(registra_jitter(tp, ritardo));
     copia_istante(&(tp->at), t); // Prossima attivazione
     copia_istante(&(tp->dl), t); // Prossima deadline
     aggiunge_millisecondi(&(tp->at), tp->periodo);
     aggiunge_millisecondi(&(tp->dl), tp->deadline);
-    al_unlock_mutex(task_mutex);
+    pthread_mutex_unlock(mutex_task(tp));
+
+    watchdog_arma(tp);  // Il watchdog segnala il miss anche se il job non termina
+    srp_inizio_job(tp); // Con SRP il primo job parte solo sopra il ceiling di sistema
+    STRUMENTO(contatori_inizio_job(tp)); // Il job inizia qui: prima lettura dei contatori
+}
+
+// Prepara il job rilasciato a rilascio: at e dl del nuovo ciclo, tempo di blocco
+// del job appena concluso, ritardo del rilascio (< 0 = non misurato) e watchdog.
+// La deadline assoluta si calcola dal rilascio: sommare la deadline relativa a
+// quella precedente la farebbe slittare se deadline != periodo
+static void prepara_job(parametri *tp, struct timespec rilascio, long long ritardo)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    copia_istante(&(tp->at), rilascio);
+    aggiunge_millisecondi(&(tp->at), tp->periodo);
+    copia_istante(&(tp->dl), rilascio);
+    aggiunge_millisecondi(&(tp->dl), tp->deadline);
+    tp->blocco_tot_ns += tp->blocco_job_ns;
+    if (tp->blocco_job_ns > tp->blocco_max_ns)
+        tp->blocco_max_ns = tp->blocco_job_ns;
+    tp->blocco_job_ns = 0;
+    STRUMENTO(registra_jitter(tp, ritardo));
+    pthread_mutex_unlock(mutex_task(tp));
+
+    watchdog_arma(tp);  // Il watchdog segnala il miss anche se il job non termina
+}
+
+// Riporta il thread alla priorità del task se il watchdog l'ha degradata nel job precedente
+static void ripristina_priorita(parametri *tp)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    int degradato = tp->degradato;
+    int priorita = tp->priorita;
+    tp->degradato = 0;
+    pthread_mutex_unlock(mutex_task(tp));
+    if (!degradato)
+        return;
+    int ret = pthread_setschedprio(pthread_self(), priorita);
+    if (ret)
+    {
+        errno = ret;
+        perror("ripristina_priorita");
+    }
+}
+
+// Vero se è stata chiesta la terminazione del task
+static int terminazione_richiesta(parametri *tp)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    int t = tp->termina;
+    pthread_mutex_unlock(mutex_task(tp));
+    return t;
 }
 
 // Attende fino al prossimo periodo del task (sleep assoluto)
-void attende_periodo(parametri *tp)
+int attende_periodo(parametri *tp)
 {
     // Lettura protetta della prossima attivazione
-    al_lock_mutex(task_mutex);
+    pthread_mutex_lock(mutex_task(tp));
     struct timespec at_copy = tp->at;
-    al_unlock_mutex(task_mutex);
+    modo_rilascio modo = tp->attesa;
+    int termina = tp->termina;
+    pthread_mutex_unlock(mutex_task(tp));
+    if (termina)
+        return 1;
 
-    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at_copy, NULL);
+    long long ritardo = attende_rilascio(tp, modo, &at_copy);
 
-    // Aggiorna at e dl per il prossimo ciclo (scrittura protetta)
-    al_lock_mutex(task_mutex);
-    aggiunge_millisecondi(&(tp->at), tp->periodo);
-    aggiunge_millisecondi(&(tp->dl), tp->deadline);
-    al_unlock_mutex(task_mutex);
+    // Una richiesta arrivata durante l'attesa ferma il task prima del nuovo job
+    if (terminazione_richiesta(tp))
+        return 1;
+
+    // Confine del rilascio: una modifica in attesa vale dal job che parte adesso
+    applica_modifica(tp, 1);
+    ripristina_priorita(tp); // Un degrado del watchdog vale solo per il job in ritardo
+    prepara_job(tp, at_copy, ritardo);
+    srp_inizio_job(tp); // Con SRP il job parte solo sopra il ceiling di sistema
+    STRUMENTO(contatori_inizio_job(tp)); // Il job inizia qui: prima lettura dei contatori
+    return 0;
+}
+
+// Confine di rilascio per chi attende il rilascio da sé (esecutore a coroutine)
+void time0_rilascio_job(parametri *tp, struct timespec rilascio, long long ritardo_ns)
+{
+    applica_modifica(tp, 0);
+    prepara_job(tp, rilascio, ritardo_ns);
+    STRUMENTO(contatori_inizio_job(tp));
+}
+
+// Chiede al task di terminare al prossimo confine di rilascio
+void termina_task(parametri *tp)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    tp->termina = 1;
+    pthread_mutex_unlock(mutex_task(tp));
+}
+
+// Chiede la terminazione e attende l'uscita del thread
+int rimuove_task(parametri *tp)
+{
+    termina_task(tp);
+    int ret = pthread_join(tp->thread, NULL);
+    if (ret)
+    {
+        errno = ret;
+        perror("rimuove_task");
+        return -1;
+    }
+    watchdog_disarma(tp); // Per un thread uscito senza passare da deadline_miss
+    return 0;
+}
+
+// Raccoglie il thread del task se è già uscito, senza attendere
+int raccoglie_task(parametri *tp)
+{
+    int ret = pthread_tryjoin_np(tp->thread, NULL);
+    if (ret == EBUSY)
+        return 1;
+    if (ret)
+    {
+        errno = ret;
+        perror("raccoglie_task");
+        return -1;
+    }
+    watchdog_disarma(tp);
+    return 0;
+}
+
+// Destinazione delle notifiche dei task
+static notifica_fn destinazione = NULL;
+static void *destinazione_utente = NULL;
+
+// Imposta la destinazione delle notifiche
+void time0_imposta_notifiche(notifica_fn fn, void *utente)
+{
+    destinazione_utente = utente;
+    destinazione = fn;
+}
+
+// Destinazione corrente delle notifiche
+notifica_fn time0_notifiche(void **utente)
+{
+    if (utente)
+        *utente = destinazione_utente;
+    return destinazione;
+}
+
+// Invia una notifica del task alla destinazione corrente
+void notifica_task(parametri *tp, tipo_notifica tipo)
+{
+    notifica_fn fn = destinazione;
+    if (fn)
+        fn(destinazione_utente, tp, tipo);
+}
+
+// Conta una deadline persa e la notifica alla parte grafica
+void segnala_deadline_persa(parametri *tp)
+{
+    pthread_mutex_lock(mutex_task(tp));
+    // Incremento atomico: l'anello degli eventi (evring) lo legge senza il mutex
+    int totale = __atomic_add_fetch(&tp->deadperse, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(mutex_task(tp));
+
+    // Notifica la parte grafica della deadline persa
+    notifica_task(tp, NOTIFICA_MISS);
+
+    printf("Task %d: Deadline persa! (totale: %d) a %.3f sec\n",
+           tp->id, totale, get_time_seconds());
 }
 
 // Verifica se la deadline è stata mancata e notifica la parte grafica
 int deadline_miss(parametri *tp)
 {
+    // Il watchdog può aver già segnalato il miss mentre il job era in corso:
+    // si disarma prima di leggere l'ora, così un miss segnalato risulta sempre tale
+    STRUMENTO(contatori_fine_job(tp)); // Il job finisce qui: seconda lettura dei contatori
+    int gia_segnalato = watchdog_disarma(tp);
+
     struct timespec adesso;
     clock_gettime(CLOCK_MONOTONIC, &adesso);
 
-    al_lock_mutex(task_mutex);
+    pthread_mutex_lock(mutex_task(tp));
     int miss = confronta_istanti(adesso, tp->dl) > 0;
-    if (miss)
-    {
-        tp->deadperse++; // Incrementa il contatore di deadline perse
-        al_unlock_mutex(task_mutex);
-
-        // Notifica la parte grafica della deadline persa
-        bouncing_balls_notify_deadline_miss(tp->id);
+    pthread_mutex_unlock(mutex_task(tp));
 
-        printf("Task %d: Deadline persa! (totale: %d) a %.3f sec\n",
-               tp->id, tp->deadperse, get_time_seconds());
-        return 1;
-    }
-    al_unlock_mutex(task_mutex);
-    return 0;
+    if (miss && !gia_segnalato)
+        segnala_deadline_persa(tp);
+    return miss || gia_segnalato;
 }
 
 // Crea un nuovo thread per il task, impostando la politica di scheduling e la priorità
 void crea_task(void *(*miotask)(void *), parametri *par)
 {
-    pthread_t tid;
     pthread_attr_t attribute;
     struct sched_param param;
     int tret;
@@ -180,16 +590,29 @@ void crea_task(void *(*miotask)(void *), parametri *par)
 
     if (policy == SCHED_OTHER)
         par->priorita = 0;
-    else
+    else if (!par->priorita_fissa || par->priorita < min_prio || par->priorita > max_prio)
         par->priorita = min_prio + rand() % (max_prio - min_prio + 1);
 
     param.sched_priority = par->priorita;
     pthread_attr_setschedparam(&attribute, &param);
 
+    if (par->affinita)
+    {
+        // Fissa il thread sulle CPU indicate dalla maschera
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu = 0; cpu < 64; cpu++)
+            if (par->affinita & (1ULL << cpu))
+                CPU_SET(cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attribute, sizeof(cpu_set_t), &cpuset);
+    }
+
     printf("Chiamo pthread_create per task id=%d (policy=%d, prio=%d)\n",
            par->id, par->sched, param.sched_priority);
 
-    tret = pthread_create(&tid, &attribute, miotask, (void *)par);
+    // Il thread va salvato nei parametri prima che parta (serve al watchdog)
+    par->thread_condiviso = 0;
+    tret = pthread_create(&par->thread, &attribute, miotask, (void *)par);
     if (tret)
         handle_error_en(tret, "pthread_create");
 }
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+#include <allegro5/allegro_font.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timeline.h"
+
+// Costanti di layout
+#define TIMELINE_MAX_EVENTS 4096   // Eventi in attesa di essere disegnati
+#define TIMELINE_LANE_HEIGHT 10    // Altezza di una corsia in pixel
+#define TIMELINE_LABEL_WIDTH 36    // Spazio a sinistra per gli ID dei task
+
+// Evento in attesa di essere disegnato
+typedef struct {
+    int lane;
+    timeline_event_type type;
+    long long ts_ns;
+} timeline_event;
+
+// Stato di una corsia
+typedef struct {
+    int task_id;               // Task associato (0 = corsia libera)
+    bool open;                 // Esecuzione in corso
+    long long drawn_until_ns;  // Fin dove è già stato disegnato il segmento aperto
+} timeline_lane;
+
+struct timeline {
+    int max_lanes;
+    int window_ms;
+    timeline_lane *lanes;
+    timeline_event events[TIMELINE_MAX_EVENTS]; // Coda circolare degli eventi
+    int ev_head, ev_count;
+    int dropped;               // Eventi scartati per coda piena
+    ALLEGRO_BITMAP *bmp[2];    // Bitmap persistenti (una sorgente, una destinazione della traslazione)
+    int cur;                   // Bitmap attualmente valida
+    int bmp_w, bmp_h;
+    long long edge_ns;         // Istante che corrisponde al bordo destro della bitmap
+    double ns_per_px;          // Nanosecondi rappresentati da un pixel
+    bool valid;                // edge_ns inizializzato e bitmap pulita
+};
+
+static long long timespec_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * 1000000000LL + t->tv_nsec;
+}
+
+// Crea una timeline con al più max_lanes corsie e una finestra di window_ms millisecondi
+timeline *timeline_create(int max_lanes, int window_ms) {
+    timeline *tl = calloc(1, sizeof(timeline));
+    if (!tl) return NULL;
+    tl->lanes = calloc(max_lanes, sizeof(timeline_lane));
+    if (!tl->lanes) {
+        free(tl);
+        return NULL;
+    }
+    tl->max_lanes = max_lanes;
+    tl->window_ms = window_ms > 0 ? window_ms : 10000;
+    return tl;
+}
+
+// Libera la timeline e le sue bitmap
+void timeline_destroy(timeline *tl) {
+    if (!tl) return;
+    if (tl->bmp[0]) al_destroy_bitmap(tl->bmp[0]);
+    if (tl->bmp[1]) al_destroy_bitmap(tl->bmp[1]);
+    free(tl->lanes);
+    free(tl);
+}
+
+// Cambia la durata della finestra visualizzata
+void timeline_set_window(timeline *tl, int window_ms) {
+    if (window_ms <= 0 || window_ms == tl->window_ms) return;
+    tl->window_ms = window_ms;
+    tl->valid = false; // Cambia la scala: la storia già disegnata non è più valida
+}
+
+// Registra un evento sulla corsia lane
+void timeline_record(timeline *tl, int lane, int task_id, timeline_event_type type, const struct timespec *ts) {
+    if (!tl || lane < 0 || lane >= tl->max_lanes) return;
+    tl->lanes[lane].task_id = task_id;
+    if (tl->ev_count == TIMELINE_MAX_EVENTS) {
+        tl->dropped++;
+        return;
+    }
+    timeline_event *ev = &tl->events[(tl->ev_head + tl->ev_count) % TIMELINE_MAX_EVENTS];
+    ev->lane = lane;
+    ev->type = type;
+    ev->ts_ns = timespec_ns(ts);
+    tl->ev_count++;
+}
+
+// Libera una corsia
+void timeline_release_lane(timeline *tl, int lane) {
+    if (!tl || lane < 0 || lane >= tl->max_lanes) return;
+    tl->lanes[lane].task_id = 0;
+    tl->lanes[lane].open = false;
+}
+
+// Converte un istante nella colonna della bitmap
+static float timeline_x(timeline *tl, long long ts_ns) {
+    float x = tl->bmp_w - (float)((tl->edge_ns - ts_ns) / tl->ns_per_px);
+    return x < 0 ? 0 : x;
+}
+
+// Disegna un segmento di esecuzione [from, to] sulla corsia lane
+static void timeline_draw_segment(timeline *tl, int lane, long long from_ns, long long to_ns) {
+    float y = lane * TIMELINE_LANE_HEIGHT + 1;
+    float x0 = timeline_x(tl, from_ns), x1 = timeline_x(tl, to_ns);
+    if (x1 - x0 < 1.0f) x1 = x0 + 1.0f; // Anche i job brevissimi restano visibili
+    al_draw_filled_rectangle(x0, y + 2, x1, y + TIMELINE_LANE_HEIGHT - 2, al_map_rgb(60, 200, 90));
+}
+
+// Porta la bitmap all'istante now: trasla il contenuto e disegna solo gli eventi nuovi
+static void timeline_advance(timeline *tl, long long now_ns) {
+    ALLEGRO_COLOR bg = al_map_rgb(24, 24, 44);
+    if (!tl->valid) {
+        for (int k = 0; k < 2; k++) {
+            al_set_target_bitmap(tl->bmp[k]);
+            al_clear_to_color(bg);
+        }
+        tl->edge_ns = now_ns;
+        for (int l = 0; l < tl->max_lanes; l++)
+            tl->lanes[l].drawn_until_ns = now_ns;
+        tl->valid = true;
+    }
+    long long shift_px = (long long)((now_ns - tl->edge_ns) / tl->ns_per_px);
+    if (shift_px > 0) {
+        tl->edge_ns += (long long)(shift_px * tl->ns_per_px);
+        ALLEGRO_BITMAP *src = tl->bmp[tl->cur], *dst = tl->bmp[1 - tl->cur];
+        al_set_target_bitmap(dst);
+        if (shift_px < tl->bmp_w)
+            al_draw_bitmap_region(src, shift_px, 0, tl->bmp_w - shift_px, tl->bmp_h, 0, 0, 0);
+        float clear_from = shift_px < tl->bmp_w ? tl->bmp_w - shift_px : 0;
+        al_draw_filled_rectangle(clear_from, 0, tl->bmp_w, tl->bmp_h, bg);
+        tl->cur = 1 - tl->cur;
+    }
+    al_set_target_bitmap(tl->bmp[tl->cur]);
+    // Eventi fino al bordo destro; quelli più recenti restano in coda per il prossimo frame
+    while (tl->ev_count > 0) {
+        timeline_event *ev = &tl->events[tl->ev_head];
+        if (ev->ts_ns > tl->edge_ns) break;
+        timeline_lane *ln = &tl->lanes[ev->lane];
+        float y = ev->lane * TIMELINE_LANE_HEIGHT;
+        float x = timeline_x(tl, ev->ts_ns);
+        switch (ev->type) {
+        case TIMELINE_RELEASE:
+            al_draw_line(x, y, x, y + TIMELINE_LANE_HEIGHT, al_map_rgb(200, 200, 200), 1.0f);
+            break;
+        case TIMELINE_EXEC_START:
+            ln->open = true;
+            ln->drawn_until_ns = ev->ts_ns;
+            break;
+        case TIMELINE_EXEC_END:
+            if (ln->open)
+                timeline_draw_segment(tl, ev->lane, ln->drawn_until_ns, ev->ts_ns);
+            ln->open = false;
+            break;
+        case TIMELINE_MISS:
+            al_draw_filled_rectangle(x - 1, y, x + 2, y + TIMELINE_LANE_HEIGHT, al_map_rgb(255, 40, 40));
+            break;
+        }
+        tl->ev_head = (tl->ev_head + 1) % TIMELINE_MAX_EVENTS;
+        tl->ev_count--;
+    }
+    // Prolunga i segmenti ancora aperti fino al bordo destro
+    int visible = tl->bmp_h / TIMELINE_LANE_HEIGHT;
+    for (int l = 0; l < tl->max_lanes && l < visible; l++) {
+        timeline_lane *ln = &tl->lanes[l];
+        if (ln->open && ln->drawn_until_ns < tl->edge_ns) {
+            timeline_draw_segment(tl, l, ln->drawn_until_ns, tl->edge_ns);
+            ln->drawn_until_ns = tl->edge_ns;
+        }
+    }
+}
+
+// Disegna la timeline nel rettangolo (x, y, w, h) del target corrente all'istante now
+void timeline_draw(timeline *tl, ALLEGRO_FONT *font, int x, int y, int w, int h, const struct timespec *now) {
+    if (!tl) return;
+    int plot_w = w - TIMELINE_LABEL_WIDTH;
+    if (plot_w <= 0 || h < TIMELINE_LANE_HEIGHT) return;
+    ALLEGRO_BITMAP *target = al_get_target_bitmap();
+    if (!tl->bmp[0] || tl->bmp_w != plot_w || tl->bmp_h != h) {
+        // Nuove dimensioni: si ricreano le bitmap e si riparte da una finestra vuota
+        for (int k = 0; k < 2; k++) {
+            if (tl->bmp[k]) al_destroy_bitmap(tl->bmp[k]);
+            tl->bmp[k] = al_create_bitmap(plot_w, h);
+        }
+        if (!tl->bmp[0] || !tl->bmp[1]) {
+            al_set_target_bitmap(target);
+            return;
+        }
+        tl->bmp_w = plot_w;
+        tl->bmp_h = h;
+        tl->valid = false;
+    }
+    tl->ns_per_px = tl->window_ms * 1000000.0 / plot_w;
+    timeline_advance(tl, timespec_ns(now));
+    al_set_target_bitmap(target);
+
+    al_draw_filled_rectangle(x, y, x + TIMELINE_LABEL_WIDTH, y + h, al_map_rgb(16, 16, 32));
+    al_draw_bitmap(tl->bmp[tl->cur], x + TIMELINE_LABEL_WIDTH, y, 0);
+    int visible = h / TIMELINE_LANE_HEIGHT;
+    for (int l = 0; l < tl->max_lanes && l < visible; l++) {
+        if (tl->lanes[l].task_id <= 0) continue;
+        char label[16];
+        snprintf(label, sizeof(label), "%d", tl->lanes[l].task_id);
+        al_draw_text(font, al_map_rgb(200, 200, 200), x + 2, y + l * TIMELINE_LANE_HEIGHT + 1, 0, label);
+    }
+    char caption[64];
+    snprintf(caption, sizeof(caption), "ultimi %d ms", tl->window_ms);
+    al_draw_text(font, al_map_rgb(150, 150, 180), x + w - 4, y + h - 10, ALLEGRO_ALIGN_RIGHT, caption);
+    al_draw_rectangle(x, y, x + w, y + h, al_map_rgb(80, 80, 120), 1.0f);
+}
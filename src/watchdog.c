@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "watchdog.h"
+
+// Voce dello heap: deadline copiata all'armo (tp->dl cambia sotto il mutex del task)
+typedef struct {
+    struct timespec dl;
+    parametri *tp;
+} voce_watchdog;
+
+// *** STATO DEL WATCHDOG ***
+static pthread_mutex_t *wd_mutex = NULL;   // Priority inheritance: lo usano i task real-time
+static pthread_cond_t wd_cond;             // Sveglia il thread (su CLOCK_MONOTONIC)
+static pthread_cond_t wd_fine_cond;        // Fine di una segnalazione fuori dal mutex
+static parametri *wd_corrente = NULL;      // Task di cui si sta segnalando il miss
+static pthread_once_t wd_once = PTHREAD_ONCE_INIT;
+static voce_watchdog *wd_heap = NULL;      // Min-heap sulle deadline
+static int wd_dim = 0, wd_cap = 0;
+static pthread_t wd_thread;
+static volatile int wd_attivo = 0;         // Letto senza mutex per rendere gratuito armo/disarmo a watchdog spento
+static int wd_stop = 0;
+static watchdog_callback wd_callback = NULL;
+static void *wd_utente = NULL;
+
+static void crea_sincronizzazione(void)
+{
+    wd_mutex = crea_mutex_pi();
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wd_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&wd_fine_cond, NULL);
+}
+
+// *** HEAP (da chiamare con wd_mutex acquisito) ***
+// tp->wd_indice è la posizione nello heap + 1 (0 = non armato)
+
+static void metti(int i, voce_watchdog v)
+{
+    wd_heap[i] = v;
+    v.tp->wd_indice = i + 1;
+}
+
+static void risale(int i)
+{
+    voce_watchdog v = wd_heap[i];
+    while (i > 0)
+    {
+        int padre = (i - 1) / 2;
+        if (confronta_istanti(wd_heap[padre].dl, v.dl) <= 0)
+            break;
+        metti(i, wd_heap[padre]);
+        i = padre;
+    }
+    metti(i, v);
+}
+
+static void scende(int i)
+{
+    voce_watchdog v = wd_heap[i];
+    for (;;)
+    {
+        int figlio = 2 * i + 1;
+        if (figlio >= wd_dim)
+            break;
+        if (figlio + 1 < wd_dim && confronta_istanti(wd_heap[figlio + 1].dl, wd_heap[figlio].dl) < 0)
+            figlio++;
+        if (confronta_istanti(v.dl, wd_heap[figlio].dl) <= 0)
+            break;
+        metti(i, wd_heap[figlio]);
+        i = figlio;
+    }
+    metti(i, v);
+}
+
+static void rimuove(int i)
+{
+    wd_heap[i].tp->wd_indice = 0;
+    wd_dim--;
+    if (i == wd_dim)
+        return;
+    metti(i, wd_heap[wd_dim]);
+    risale(i);
+    scende(wd_heap[i].tp->wd_indice - 1);
+}
+
+// *** THREAD DI MONITORAGGIO ***
+
+static void *watchdog_thread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(wd_mutex);
+    while (!wd_stop)
+    {
+        if (wd_dim == 0)
+        {
+            pthread_cond_wait(&wd_cond, wd_mutex);
+            continue;
+        }
+        struct timespec adesso;
+        clock_gettime(CLOCK_MONOTONIC, &adesso);
+        voce_watchdog prima = wd_heap[0];
+        if (confronta_istanti(adesso, prima.dl) <= 0)
+        {
+            // Nessuna deadline superata: dorme fino alla più vicina (o a un nuovo armo)
+            pthread_cond_timedwait(&wd_cond, wd_mutex, &prima.dl);
+            continue;
+        }
+        // Deadline superata con il job ancora in corso
+        rimuove(0);
+        prima.tp->wd_scattato = 1;
+        wd_corrente = prima.tp;
+        pthread_mutex_unlock(wd_mutex);
+
+        segnala_deadline_persa(prima.tp);
+        if (wd_callback)
+            wd_callback(prima.tp, wd_utente);
+
+        pthread_mutex_lock(wd_mutex);
+        wd_corrente = NULL;
+        pthread_cond_broadcast(&wd_fine_cond);
+    }
+    pthread_mutex_unlock(wd_mutex);
+    return NULL;
+}
+
+// Avvia il thread del watchdog
+int watchdog_avvia(watchdog_callback cb, void *utente)
+{
+    pthread_once(&wd_once, crea_sincronizzazione);
+    if (!wd_mutex)
+        return ENOMEM;
+    if (wd_attivo)
+        return EBUSY;
+    wd_callback = cb;
+    wd_utente = utente;
+    wd_stop = 0;
+
+    // Deve poter prelazionare i task che controlla: prova SCHED_FIFO alla massima priorità
+    pthread_attr_t attr;
+    struct sched_param param;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    int ret = pthread_create(&wd_thread, &attr, watchdog_thread, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret == EPERM)
+    {
+        printf("Watchdog: SCHED_FIFO non permesso, uso la politica predefinita\n");
+        ret = pthread_create(&wd_thread, NULL, watchdog_thread, NULL);
+    }
+    if (ret == 0)
+        wd_attivo = 1;
+    return ret;
+}
+
+// Ferma il thread del watchdog e disarma tutti i task
+void watchdog_ferma(void)
+{
+    if (!wd_attivo)
+        return;
+    pthread_mutex_lock(wd_mutex);
+    wd_attivo = 0;
+    wd_stop = 1;
+    pthread_cond_signal(&wd_cond);
+    pthread_mutex_unlock(wd_mutex);
+    pthread_join(wd_thread, NULL);
+
+    pthread_mutex_lock(wd_mutex);
+    for (int i = 0; i < wd_dim; i++)
+        wd_heap[i].tp->wd_indice = 0;
+    wd_dim = 0;
+    free(wd_heap);
+    wd_heap = NULL;
+    wd_cap = 0;
+    pthread_mutex_unlock(wd_mutex);
+}
+
+// Arma il watchdog sulla deadline corrente del task
+void watchdog_arma(parametri *tp)
+{
+    if (!wd_attivo)
+        return;
+    pthread_mutex_lock(mutex_task(tp));
+    struct timespec dl = tp->dl;
+    pthread_mutex_unlock(mutex_task(tp));
+
+    pthread_mutex_lock(wd_mutex);
+    if (!wd_attivo)
+    {
+        pthread_mutex_unlock(wd_mutex);
+        return;
+    }
+    tp->wd_scattato = 0; // Nuovo job: nessun miss ancora segnalato
+    int i = tp->wd_indice - 1;
+    if (i < 0)
+    {
+        if (wd_dim == wd_cap)
+        {
+            int cap = wd_cap ? 2 * wd_cap : 64;
+            voce_watchdog *h = realloc(wd_heap, cap * sizeof(voce_watchdog));
+            if (!h)
+            {
+                pthread_mutex_unlock(wd_mutex);
+                return; // Senza memoria il job resta controllato solo da deadline_miss
+            }
+            wd_heap = h;
+            wd_cap = cap;
+        }
+        i = wd_dim++;
+    }
+    metti(i, (voce_watchdog){dl, tp});
+    risale(i);
+    scende(tp->wd_indice - 1);
+    // Il thread va svegliato solo se la deadline più vicina è cambiata
+    if (wd_heap[0].tp == tp)
+        pthread_cond_signal(&wd_cond);
+    pthread_mutex_unlock(wd_mutex);
+}
+
+// Disarma il watchdog per il job corrente del task
+int watchdog_disarma(parametri *tp)
+{
+    if (!wd_attivo)
+        return 0;
+    pthread_mutex_lock(wd_mutex);
+    if (tp->wd_indice > 0)
+        rimuove(tp->wd_indice - 1);
+    // Al ritorno il watchdog non sta più usando tp (serve a rimuove_task prima di riusarlo)
+    while (wd_corrente == tp)
+        pthread_cond_wait(&wd_fine_cond, wd_mutex);
+    int scattato = tp->wd_scattato;
+    pthread_mutex_unlock(wd_mutex);
+    return scattato;
+}
+
+// Porta il thread del task alla priorità minima della sua politica per il resto del job
+// (tp->priorita resta quella del task: attende_periodo la ripristina al prossimo rilascio)
+void watchdog_degrada_priorita(parametri *tp, void *utente)
+{
+    (void)utente;
+    // Un task a coroutine gira nel worker insieme agli altri task della CPU:
+    // degradare il worker abbasserebbe la priorità di tutti
+    if (tp->thread_condiviso)
+        return;
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(tp->thread, &policy, &param) != 0)
+        return;
+    int minima = sched_get_priority_min(policy);
+    if (minima < 0 || param.sched_priority <= minima)
+        return;
+    if (pthread_setschedprio(tp->thread, minima) == 0)
+    {
+        pthread_mutex_lock(mutex_task(tp));
+        tp->degradato = 1;
+        pthread_mutex_unlock(mutex_task(tp));
+        printf("Watchdog: task %d degradato a priorità %d fino al prossimo rilascio\n", tp->id, minima);
+    }
+}